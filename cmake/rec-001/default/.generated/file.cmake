@@ -16,7 +16,17 @@ foreach(source_file ${rec_001_default_default_XC8_FILE_TYPE_assemblePreprocess})
 endforeach()
 
 set(rec_001_default_default_XC8_FILE_TYPE_compile
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/bus.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/command.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/console.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/control.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/encoder.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/frame.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/log.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/main.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/motor.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/ramp.c"
+    "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/telemetry.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/timer.c"
     "${CMAKE_CURRENT_SOURCE_DIR}/../../../firmware/uart.c")
 set_source_files_properties(${rec_001_default_default_XC8_FILE_TYPE_compile} PROPERTIES LANGUAGE C)
@@ -0,0 +1,147 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "bus.h"
+#include "command.h"
+#include "frame.h"
+#include "main.h"
+#include "uart.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef BUS_ADDRESS
+#define BUS_ADDRESS 0x01
+#endif
+
+#if (BUS_ADDRESS == BUS_HOST) || (BUS_ADDRESS == BUS_BROADCAST)
+#error "BUS_ADDRESS must be between 0x01 and 0xFE"
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define BUS_REQUEST_MAX (sizeof(bus_header_t) + COMMAND_ARGUMENTS_MAX * sizeof(int32_t))
+#define BUS_REPLY_SIZE  (sizeof(bus_header_t) + 1)
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   uint8_t buffer[FRAME_SIZE(BUS_REQUEST_MAX)];
+   size_t scanned;
+   size_t errors;
+
+} bus;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _bus_reply(uint8_t command, uint8_t status)
+{
+   uint8_t reply[BUS_REPLY_SIZE] = { BUS_HOST, BUS_ADDRESS, command, status };
+   size_t length = frame_encode(bus.buffer, reply, sizeof(reply));
+
+   // the host waits for the whole reply, so it is never cut short by the TX policy
+   uart_write_policy(bus.buffer, length, UART_TX_BLOCK);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _bus_execute(const command_t* commands, size_t count, size_t length)
+{
+   const bus_header_t* header = (const bus_header_t*) bus.buffer;
+   int32_t argv[COMMAND_ARGUMENTS_MAX];
+   uint8_t status = BUS_STATUS_UNKNOWN;
+
+   if (!frame_decode(bus.buffer, &length) || (length < sizeof(bus_header_t)))
+   {
+      bus.errors++;
+      return;
+   }
+
+   // replies from other nodes and requests for them share the line
+   if ((header->destination != BUS_ADDRESS) && (header->destination != BUS_BROADCAST))
+      return;
+
+   // a command is its index in the table, followed by its arguments as little endian int32
+   if (header->command < count)
+   {
+      const command_t* command = &commands[header->command];
+
+      status = BUS_STATUS_ERROR;
+
+      if ((length - sizeof(bus_header_t)) == (command->arguments * sizeof(int32_t)))
+      {
+         memcpy(argv, &bus.buffer[sizeof(bus_header_t)], command->arguments * sizeof(int32_t));
+
+         if (command->fx(argv))
+            status = BUS_STATUS_OK;
+      }
+   }
+
+   // nodes never answer a broadcast, they would all drive the line at once
+   if (header->destination != BUS_BROADCAST)
+      _bus_reply(header->command, status);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void bus_update(const command_t* commands, size_t count)
+{
+   size_t length = uart_rx_length();
+
+   // like command_update(), only the bytes that arrived since the last call are searched for a delimiter
+   while (bus.scanned < length)
+   {
+      if (uart_rx_peek(bus.scanned++) == 0)
+      {
+         size_t size = bus.scanned - 1;
+
+         if (size > sizeof(bus.buffer))
+         {
+            uart_rx_skip(bus.scanned);
+            bus.errors++;
+         }
+         else
+         {
+            uart_read(bus.buffer, size, 0);
+            uart_rx_skip(1);
+
+            if (size > 0)
+               _bus_execute(commands, count, size);
+         }
+
+         bus.scanned = 0;
+         length = uart_rx_length();
+      }
+   }
+
+   // a frame longer than any request is discarded as it arrives, it can never be for this node
+   if (bus.scanned > sizeof(bus.buffer))
+   {
+      uart_rx_skip(bus.scanned);
+      bus.scanned = 0;
+      bus.errors++;
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t bus_errors(bool reset)
+{
+   size_t errors = bus.errors;
+
+   if (reset)
+      bus.errors = 0;
+
+   return errors;
+}
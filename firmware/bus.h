@@ -0,0 +1,46 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef BUS_H
+#define BUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "command.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define BUS_HOST      0x00
+#define BUS_BROADCAST 0xFF
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define BUS_STATUS_OK      0x00
+#define BUS_STATUS_ERROR   0x01
+#define BUS_STATUS_UNKNOWN 0x02
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+typedef struct __attribute__((packed))
+{
+   uint8_t destination;
+   uint8_t source;
+   uint8_t command;
+
+} bus_header_t;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void bus_update(const command_t* commands, size_t count);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t bus_errors(bool reset);
+
+#endif
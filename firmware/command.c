@@ -0,0 +1,153 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "command.h"
+#include "console.h"
+#include "main.h"
+#include "uart.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static size_t scanned;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static size_t _command_token(size_t* index, size_t end, size_t* start)
+{
+   // tokens are referred to by their position in the RX buffer, nothing is copied out
+   while ((*index < end) && (uart_rx_peek(*index) == ' '))
+      (*index)++;
+
+   *start = *index;
+
+   while ((*index < end) && (uart_rx_peek(*index) != ' '))
+      (*index)++;
+
+   return *index - *start;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool _command_match(size_t start, size_t length, const char* name)
+{
+   size_t i;
+
+   for (i = 0; i < length; i++)
+   {
+      if (uart_rx_peek(start + i) != name[i])
+         return false;
+   }
+
+   return name[length] == '\0';
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool _command_number(size_t start, size_t length, int32_t* value)
+{
+   bool negative = false;
+   uint32_t magnitude = 0;
+   uint32_t limit = INT32_MAX;
+   size_t i = 0;
+
+   if (uart_rx_peek(start) == '-')
+   {
+      negative = true;
+      limit++;
+      i++;
+   }
+
+   if (i == length)
+      return false;
+
+   for (; i < length; i++)
+   {
+      int c = uart_rx_peek(start + i);
+
+      if ((c < '0') || (c > '9'))
+         return false;
+
+      // a number that does not fit int32_t is rejected rather than wrapped into some valid looking value
+      if (magnitude > (limit - (c - '0')) / 10)
+         return false;
+
+      magnitude = magnitude * 10 + (c - '0');
+   }
+
+   *value = negative ? (int32_t) (0 - magnitude) : (int32_t) magnitude;
+
+   return true;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _command_execute(const command_t* commands, size_t count, size_t end)
+{
+   int32_t argv[COMMAND_ARGUMENTS_MAX];
+   const command_t* command = NULL;
+   uint8_t argc = 0;
+   size_t index = 0;
+   size_t start;
+   size_t length;
+   size_t i;
+
+   length = _command_token(&index, end, &start);
+
+   if (length == 0)
+      return;
+
+   for (i = 0; (i < count) && (command == NULL); i++)
+   {
+      if (_command_match(start, length, commands[i].name))
+         command = &commands[i];
+   }
+
+   while ((command != NULL) && ((length = _command_token(&index, end, &start)) > 0))
+   {
+      if ((argc >= command->arguments) || !_command_number(start, length, &argv[argc++]))
+         command = NULL;
+   }
+
+   if ((command != NULL) && (argc == command->arguments) && command->fx(argv))
+      console_str("OK\n");
+   else
+      console_str("ERR\n");
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void command_update(const command_t* commands, size_t count)
+{
+   size_t length = uart_rx_length();
+
+   // only the bytes that arrived since the last call are searched for the end of the line
+   while (scanned < length)
+   {
+      int c = uart_rx_peek(scanned++);
+
+      if ((c == '\r') || (c == '\n'))
+      {
+         _command_execute(commands, count, scanned - 1);
+         uart_rx_skip(scanned);
+         scanned = 0;
+         length = uart_rx_length();
+      }
+   }
+
+   // a line that fills the whole buffer can never be completed
+   if (scanned >= UART_RX_BUFFER_SIZE)
+   {
+      uart_rx_skip(scanned);
+      scanned = 0;
+      console_str("ERR\n");
+   }
+}
@@ -0,0 +1,32 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define COMMAND_ARGUMENTS_MAX 2
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+typedef struct
+{
+   const char* name;
+   uint8_t arguments;
+   bool (*fx)(const int32_t* argv);
+
+} command_t;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void command_update(const command_t* commands, size_t count);
+
+#endif
@@ -0,0 +1,210 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "console.h"
+#include "main.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define CONSOLE_NEGATIVE 0x01
+#define CONSOLE_HEX      0x02
+#define CONSOLE_LOWER    0x04
+#define CONSOLE_ZERO     0x08
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _console_number(uint32_t value, uint8_t flags, uint8_t width)
+{
+   char digits[10];
+   uint8_t length = 0;
+   char letter = (flags & CONSOLE_LOWER) ? 'a' : 'A';
+
+   do
+   {
+      uint8_t digit;
+
+      // hex only needs shifts, the decimal division is the one remaining library call
+      if (flags & CONSOLE_HEX)
+      {
+         digit = value & 0x0F;
+         value >>= 4;
+      }
+      else
+      {
+         digit = value % 10;
+         value /= 10;
+      }
+
+      digits[length++] = (digit < 10) ? ('0' + digit) : (letter + digit - 10);
+
+   } while (value != 0);
+
+   if (flags & CONSOLE_NEGATIVE)
+      width = (width > 0) ? width - 1 : 0;
+
+   if ((flags & (CONSOLE_NEGATIVE | CONSOLE_ZERO)) == (CONSOLE_NEGATIVE | CONSOLE_ZERO))
+      console_tx('-');
+
+   for (; width > length; width--)
+      console_tx((flags & CONSOLE_ZERO) ? '0' : ' ');
+
+   if ((flags & (CONSOLE_NEGATIVE | CONSOLE_ZERO)) == CONSOLE_NEGATIVE)
+      console_tx('-');
+
+   while (length > 0)
+      console_tx(digits[--length]);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _console_signed(int32_t value, uint8_t flags, uint8_t width)
+{
+   // negated as unsigned, so INT32_MIN does not overflow
+   if (value < 0)
+      _console_number(-(uint32_t) value, flags | CONSOLE_NEGATIVE, width);
+   else
+      _console_number(value, flags, width);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_str(const char* s)
+{
+   while (*s != '\0')
+      console_tx(*s++);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_dec(int32_t value)
+{
+   _console_signed(value, 0, 0);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_udec(uint32_t value)
+{
+   _console_number(value, 0, 0);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_hex(uint32_t value, uint8_t digits)
+{
+   _console_number(value, CONSOLE_HEX | CONSOLE_ZERO, digits);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_fixed(int32_t value, uint8_t decimals)
+{
+   uint32_t magnitude = (value < 0) ? -(uint32_t) value : (uint32_t) value;
+   uint32_t scale = 1;
+   uint8_t i;
+
+   for (i = 0; i < decimals; i++)
+      scale *= 10;
+
+   if (value < 0)
+      console_tx('-');
+
+   _console_number(magnitude / scale, 0, 0);
+
+   if (decimals > 0)
+   {
+      console_tx('.');
+      _console_number(magnitude % scale, CONSOLE_ZERO, decimals);
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_format(const char* format, const int32_t* argv, uint8_t count)
+{
+   // the printf subset log_printf() call sites use, every argument arrives as int32
+   while (*format != '\0')
+   {
+      const char* start = format;
+      uint8_t flags = 0;
+      uint8_t width = 0;
+      int32_t value;
+
+      if (*format != '%')
+      {
+         console_tx(*format++);
+         continue;
+      }
+
+      format++;
+
+      if (*format == '0')
+      {
+         flags |= CONSOLE_ZERO;
+         format++;
+      }
+
+      while ((*format >= '0') && (*format <= '9'))
+         width = width * 10 + (*format++ - '0');
+
+      while ((*format == 'l') || (*format == 'h'))
+         format++;
+
+      value = (count > 0) ? *argv : 0;
+
+      switch (*format)
+      {
+         case 'd':
+         case 'i':
+            _console_signed(value, flags, width);
+            break;
+
+         case 'u':
+            _console_number(value, flags, width);
+            break;
+
+         case 'x':
+            _console_number(value, flags | CONSOLE_HEX | CONSOLE_LOWER, width);
+            break;
+
+         case 'X':
+            _console_number(value, flags | CONSOLE_HEX, width);
+            break;
+
+         case 'c':
+            console_tx((char) value);
+            break;
+
+         case '%':
+            console_tx('%');
+            format++;
+            continue;
+
+         default:
+            // unsupported conversions are printed as written
+            while (start < format)
+               console_tx(*start++);
+            continue;
+      }
+
+      format++;
+
+      if (count > 0)
+      {
+         argv++;
+         count--;
+      }
+   }
+}
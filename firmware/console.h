@@ -0,0 +1,41 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_str(const char* s);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_dec(int32_t value);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_udec(uint32_t value);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_hex(uint32_t value, uint8_t digits);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_fixed(int32_t value, uint8_t decimals);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_format(const char* format, const int32_t* argv, uint8_t count);
+
+#endif
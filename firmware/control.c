@@ -0,0 +1,184 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "control.h"
+#include "encoder.h"
+#include "main.h"
+#include "motor.h"
+#include "ramp.h"
+#include "timer.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef CONTROL_PERIOD
+#define CONTROL_PERIOD 5
+#endif
+
+// four edges of A span at least one and a half periods, which must fit the 6.5 ms of TCB1
+#if CONTROL_PERIOD > 9
+#error "CONTROL_PERIOD is too long for the encoder period capture"
+#endif
+
+#ifndef CONTROL_KP
+#define CONTROL_KP 256
+#endif
+
+#ifndef CONTROL_KI
+#define CONTROL_KI 32
+#endif
+
+#define CONTROL_ERROR_MAX    0x7FFFL
+#define CONTROL_INTEGRAL_MAX ((int32_t) MOTOR_SPEED_MAX << 8)
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   timer_t timer;
+   uint16_t kp;
+   uint16_t ki;
+
+   int32_t setpoint;
+   int32_t velocity;
+   int32_t integral;
+
+} control;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _control_update(timer_t* timer)
+{
+   int32_t error;
+   int32_t integral;
+   int32_t output;
+
+   // a tick queued before control_stop() must not drive the motor again after a coast or brake
+   if (!timer_enabled(timer))
+      return;
+
+   control.velocity = encoder_velocity(CONTROL_PERIOD);
+
+   // the error is in edges per second, the gains are Q8 and the output is the Q15 speed of the motor
+   error = control.setpoint - control.velocity;
+
+   if (error > CONTROL_ERROR_MAX)
+      error = CONTROL_ERROR_MAX;
+   else if (error < -CONTROL_ERROR_MAX)
+      error = -CONTROL_ERROR_MAX;
+
+   integral = control.integral + (int32_t) control.ki * error;
+
+   if (integral > CONTROL_INTEGRAL_MAX)
+      integral = CONTROL_INTEGRAL_MAX;
+   else if (integral < -CONTROL_INTEGRAL_MAX)
+      integral = -CONTROL_INTEGRAL_MAX;
+
+   output = ((int32_t) control.kp * error + integral) >> 8;
+
+   // a saturated output only keeps integrating when the error pulls it back out of saturation
+   if (output > MOTOR_SPEED_MAX)
+   {
+      output = MOTOR_SPEED_MAX;
+
+      if (error > 0)
+         integral = control.integral;
+   }
+   else if (output < -MOTOR_SPEED_MAX)
+   {
+      output = -MOTOR_SPEED_MAX;
+
+      if (error < 0)
+         integral = control.integral;
+   }
+
+   control.integral = integral;
+   motor_set_speed(output);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void control_config(uint16_t kp, uint16_t ki)
+{
+   // gains up to 0x7FFF keep kp * error + integral inside 32 bits
+   control.kp = (kp > 0x7FFF) ? 0x7FFF : kp;
+   control.ki = (ki > 0x7FFF) ? 0x7FFF : ki;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void control_set(int32_t setpoint)
+{
+   control.setpoint = setpoint;
+
+   if (!timer_enabled(&control.timer))
+   {
+      // the encoder starts counting from here, not from whenever the loop last ran
+      encoder_velocity(CONTROL_PERIOD);
+      control.integral = (int32_t) motor_speed() << 8;
+
+      timer_reset(&control.timer);
+      timer_enable(&control.timer, true);
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void control_stop()
+{
+   bool active = timer_enabled(&control.timer);
+
+   // like ramp_halt(), the caller decides between coast and brake
+   timer_enable(&control.timer, false);
+
+   // the ramp takes over from the last output of the loop
+   if (active)
+      ramp_sync();
+
+   control.setpoint = 0;
+   control.velocity = 0;
+   control.integral = 0;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool control_active()
+{
+   return timer_enabled(&control.timer);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int32_t control_setpoint()
+{
+   return control.setpoint;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int32_t control_velocity()
+{
+   return control.velocity;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void control_init()
+{
+   control_config(CONTROL_KP, CONTROL_KI);
+
+   // deferred like the ramp, motor_set_speed() is never called from an interrupt
+   timer_add(&control.timer, TIMER_FLAG_PERIODIC | TIMER_FLAG_ASYNC | TIMER_FLAG_DEFER, CONTROL_PERIOD, _control_update);
+}
@@ -0,0 +1,46 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void control_config(uint16_t kp, uint16_t ki);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void control_set(int32_t setpoint);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void control_stop();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool control_active();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int32_t control_setpoint();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int32_t control_velocity();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void control_init();
+
+#endif
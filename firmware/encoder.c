@@ -0,0 +1,132 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <util/atomic.h>
+#include "encoder.h"
+#include "main.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+// PA6 is one of the fully asynchronous pins, so channel A also reaches the event system without a clock
+#define ENCODER_PORT PORTA
+#define ENCODER_A    PIN6_bm
+#define ENCODER_B    PIN7_bm
+
+// TCB1 measures the period of channel A, at CLK_PER / 2 a 16-bit count covers 6.5 ms
+#define ENCODER_CLOCK (F_CPU / 2)
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef ENCODER_EDGES_MIN
+#define ENCODER_EDGES_MIN 4
+#endif
+
+#ifndef ENCODER_EDGES_AVERAGE
+#define ENCODER_EDGES_AVERAGE 32
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   volatile int16_t count;
+   int16_t last;
+
+} encoder;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+ISR(PORTA_PORT_vect)
+{
+   uint8_t in = ENCODER_PORT.IN;
+
+   ENCODER_PORT.INTFLAGS = ENCODER_A;
+
+   // both edges of A are counted, B is ahead of A when both read the same after the edge
+   if (((in & ENCODER_A) != 0) == ((in & ENCODER_B) != 0))
+      encoder.count--;
+   else
+      encoder.count++;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int16_t encoder_count()
+{
+   int16_t count;
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      count = encoder.count;
+   }
+
+   return count;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int32_t encoder_velocity(uint16_t interval)
+{
+   int16_t count = encoder_count();
+   int16_t delta = count - encoder.last;
+   uint16_t edges = (delta < 0) ? -delta : delta;
+   uint16_t period = 0;
+
+   encoder.last = count;
+
+   // reading CCMP clears CAPT, so the flag is tested first
+   if (TCB1.INTFLAGS & TCB_CAPT_bm)
+      period = TCB1.CCMP;
+
+   if (interval == 0)
+      return 0;
+
+   // with few edges per interval the count is coarse, the last period of A then gives the better estimate
+   // the choice goes by that speed, choosing by the edge count would take the count in just the intervals the timer
+   // stretched by a tick, which read high
+   if ((period > 0) && (edges >= ENCODER_EDGES_MIN))
+   {
+      int32_t velocity = 2 * ENCODER_CLOCK / period;
+
+      if (velocity < (int32_t) ENCODER_EDGES_AVERAGE * 1000 / interval)
+         return (delta < 0) ? -velocity : velocity;
+   }
+
+   return (int32_t) delta * 1000 / interval;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void encoder_init()
+{
+   ENCODER_PORT.DIRCLR = ENCODER_A | ENCODER_B;
+   ENCODER_PORT.PIN6CTRL = PORT_PULLUPEN_bm | PORT_ISC_BOTHEDGES_gc;
+   ENCODER_PORT.PIN7CTRL = PORT_PULLUPEN_bm;
+   ENCODER_PORT.INTFLAGS = ENCODER_A;
+
+   // every rising edge of A captures the count since the previous one and restarts TCB1
+   EVSYS.ASYNCCH0 = EVSYS_ASYNCCH0_PORTA_PIN6_gc;
+   EVSYS.ASYNCUSER11 = EVSYS_ASYNCUSER11_ASYNCCH0_gc;
+
+   TCB1.CTRLA = 0;
+   TCB1.CTRLB = TCB_CNTMODE_FRQ_gc;
+   TCB1.EVCTRL = TCB_CAPTEI_bm | TCB_FILTER_bm;
+   TCB1.INTCTRL = 0;
+   TCB1.INTFLAGS = TCB_CAPT_bm;
+   TCB1.CTRLA = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+
+   encoder.count = 0;
+   encoder.last = 0;
+}
@@ -0,0 +1,26 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int16_t encoder_count();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int32_t encoder_velocity(uint16_t interval);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void encoder_init();
+
+#endif
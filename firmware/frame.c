@@ -0,0 +1,107 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "frame.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint16_t frame_crc16(uint16_t crc, const void* data, size_t length)
+{
+   // CRC-16/CCITT, polynomial 0x1021, bitwise to keep it out of flash tables
+   const uint8_t* p = data;
+   uint8_t i;
+
+   while (length-- > 0)
+   {
+      crc ^= (uint16_t) *p++ << 8;
+
+      for (i = 0; i < 8; i++)
+         crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+   }
+
+   return crc;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t frame_encode(uint8_t* buffer, const void* data, size_t length)
+{
+   // 0, COBS(data, crc little endian), 0 so that a receiver can resynchronise on either delimiter
+   const uint8_t* p = data;
+   uint16_t crc = frame_crc16(FRAME_CRC_INIT, data, length);
+   size_t code = 1;
+   size_t count = 2;
+   size_t i;
+
+   buffer[0] = 0;
+
+   for (i = 0; i < (length + 2); i++)
+   {
+      uint8_t c;
+
+      if (i < length)
+         c = p[i];
+      else if (i == length)
+         c = crc & 0xFF;
+      else
+         c = crc >> 8;
+
+      if (c != 0)
+         buffer[count++] = c;
+
+      if ((c == 0) || ((count - code) == 0xFF))
+      {
+         buffer[code] = count - code;
+         code = count++;
+      }
+   }
+
+   buffer[code] = count - code;
+   buffer[count++] = 0;
+
+   return count;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool frame_decode(uint8_t* buffer, size_t* length)
+{
+   // the bytes between two delimiters, decoded in place as COBS output is never longer than its input
+   size_t count = 0;
+   size_t i = 0;
+   uint16_t crc;
+
+   while (i < *length)
+   {
+      uint8_t code = buffer[i++];
+      uint8_t n;
+
+      if ((code == 0) || ((i + code - 1) > *length))
+         return false;
+
+      for (n = 1; n < code; n++)
+         buffer[count++] = buffer[i++];
+
+      if ((code < 0xFF) && (i < *length))
+         buffer[count++] = 0;
+   }
+
+   if (count < 2)
+      return false;
+
+   count -= 2;
+   crc = buffer[count] | ((uint16_t) buffer[count + 1] << 8);
+
+   if (frame_crc16(FRAME_CRC_INIT, buffer, count) != crc)
+      return false;
+
+   *length = count;
+
+   return true;
+}
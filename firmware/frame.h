@@ -0,0 +1,36 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define FRAME_CRC_INIT 0xFFFF
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define FRAME_SIZE(n) ((n) + 2 + ((n) + 2) / 254 + 1 + 2)
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint16_t frame_crc16(uint16_t crc, const void* data, size_t length);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t frame_encode(uint8_t* buffer, const void* data, size_t length);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool frame_decode(uint8_t* buffer, size_t* length);
+
+#endif
@@ -0,0 +1,70 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "frame.h"
+#include "log.h"
+#include "main.h"
+#include "timer.h"
+#include "uart.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define LOG_HEADER_SIZE 6
+#define LOG_RECORD_SIZE (LOG_HEADER_SIZE + LOG_ARGUMENTS_MAX * sizeof(int32_t))
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   uint8_t record[LOG_RECORD_SIZE];
+   uint8_t buffer[FRAME_SIZE(LOG_RECORD_SIZE)];
+   uint8_t sequence;
+   size_t drops;
+
+} logger;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void log_send(uint16_t id, const int32_t* argv, uint8_t count)
+{
+   uint16_t time = (uint16_t) timer_now_ms();
+   size_t length;
+
+   if (count > LOG_ARGUMENTS_MAX)
+      count = LOG_ARGUMENTS_MAX;
+
+   // type, sequence, time and the format address, followed by the arguments, all little endian
+   logger.record[0] = LOG_RECORD_MESSAGE;
+   logger.record[1] = logger.sequence++;
+   memcpy(&logger.record[2], &time, sizeof(time));
+   memcpy(&logger.record[4], &id, sizeof(id));
+   memcpy(&logger.record[LOG_HEADER_SIZE], argv, count * sizeof(int32_t));
+
+   length = frame_encode(logger.buffer, logger.record, LOG_HEADER_SIZE + count * sizeof(int32_t));
+
+   // like telemetry, a record is sent whole or not at all
+   if (uart_tx_space() >= length)
+      uart_write(logger.buffer, length);
+   else
+      logger.drops++;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t log_drops(bool reset)
+{
+   size_t drops = logger.drops;
+
+   if (reset)
+      logger.drops = 0;
+
+   return drops;
+}
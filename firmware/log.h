@@ -0,0 +1,67 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "console.h"
+#include "main.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define LOG_RECORD_MESSAGE 0x02
+#define LOG_ARGUMENTS_MAX  6
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+// GCC appends its own flags to the section name, the assembler comment character drops them so the section is left
+// without SHF_ALLOC and never reaches flash, that character is ';' for AVR and '#' for an x86 host build
+#ifdef __AVR__
+#define LOG_SECTION ".logfmt,\"\",@progbits ;"
+#else
+#define LOG_SECTION ".logfmt,\"\",@progbits #"
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifdef LOG_TOKENIZED
+#define log_printf(format, ...)                                                                                     \
+   do                                                                                                               \
+   {                                                                                                                \
+      static const char _log_format[] __attribute__((section(LOG_SECTION), used)) = format;                         \
+      const int32_t _log_argv[] = { 0, ##__VA_ARGS__ };                                                             \
+                                                                                                                    \
+      _Static_assert(SIZEOF_ARRAY(_log_argv) - 1 <= LOG_ARGUMENTS_MAX, "too many log_printf() arguments");         \
+      log_send((uint16_t) (uintptr_t) _log_format, &_log_argv[1], SIZEOF_ARRAY(_log_argv) - 1);                    \
+   } while (0)
+#elif defined(LOG_PRINTF)
+// the avr-libc printf the formatter replaced, only built by make size to compare the two images
+#include <stdio.h>
+#define log_printf(format, ...) printf(format, ##__VA_ARGS__)
+#else
+#define log_printf(format, ...)                                                                                     \
+   do                                                                                                               \
+   {                                                                                                                \
+      const int32_t _log_argv[] = { 0, ##__VA_ARGS__ };                                                             \
+                                                                                                                    \
+      console_format(format, &_log_argv[1], SIZEOF_ARRAY(_log_argv) - 1);                                           \
+   } while (0)
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void log_send(uint16_t id, const int32_t* argv, uint8_t count);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t log_drops(bool reset);
+
+#endif
@@ -11,15 +11,32 @@
 #include <stdlib.h>
 #include <util/delay.h>
 #include <xc.h>
+#include "bus.h"
+#include "command.h"
+#include "control.h"
+#include "encoder.h"
+#include "log.h"
 #include "main.h"
+#include "motor.h"
+#include "ramp.h"
+#include "telemetry.h"
 #include "timer.h"
 #include "uart.h"
 
 #define BUTTON_TIMER_DEBOUNCE 50
+#define CONSOLE_BUFFER_SIZE   16
 #define BUTTON_FORWARD ((PORTB.IN & PIN6_bm) == 0)
 #define BUTTON_REVERSE ((PORTB.IN & PIN7_bm) == 0)
-#define PWM_FREQ       50000UL
-#define PWM_HPER      ((F_CPU / PWM_FREQ) - 1)
+
+#ifdef TELEMETRY_PERIOD
+#define UART_BAUD 115200UL
+#else
+#define UART_BAUD 9600UL
+#endif
+
+#if defined(BUS_ADDRESS) && (defined(TELEMETRY_PERIOD) || defined(LOG_TOKENIZED))
+#error "telemetry and tokenized logs would talk over the other nodes on the bus"
+#endif
 
 // Pinout reference:
 // PB6: Button Forward (active low, external pullup)
@@ -50,26 +67,68 @@ static struct
    struct
    {
       timer_t main;
-      timer_t button_forward;
-      timer_t button_reverse;
+      timer16_t button_forward;
+      timer16_t button_reverse;
+#ifdef TELEMETRY_PERIOD
+      timer16_t telemetry;
+#endif
 
    } timer;
    struct{
       bool button_forward;
       bool button_reverse;
    } button;
+   struct
+   {
+      uint8_t duty;
+
+   } pwm;
 
 } runtime;
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   char buffer[CONSOLE_BUFFER_SIZE];
+   size_t length;
+
+} console;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void console_flush()
+{
+#ifdef BUS_ADDRESS
+   // only bus replies may drive the shared line
+   console.length = 0;
+#endif
+
+   if (console.length > 0)
+   {
+      uart_write(console.buffer, console.length);
+      console.length = 0;
+   }
+}
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
 static int _fputc(char c, FILE* stream)
 {
+   // output is collected into lines and handed to the UART in one piece
+   if (console.length > (CONSOLE_BUFFER_SIZE - 2))
+      console_flush();
+
    if (c == '\n')
-      uart_tx('\r');
+      console.buffer[console.length++] = '\r';
 
-   uart_tx(c);
+   console.buffer[console.length++] = c;
+
+   if (c == '\n')
+      console_flush();
 
    return 0;
 }
@@ -118,143 +177,286 @@ int console_rx()
    return c;
 }
 
-void motor_init(){
-   //PB6, PB7 <- input pins
-   //PB6 IN1 PB7 <- IN2
-   PORTB.DIRCLR = (PIN6_bm | PIN7_bm);
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void drive_motor()
+{
+   int16_t speed = ((uint32_t) runtime.pwm.duty * MOTOR_SPEED_MAX + 50) / 100;
 
-   ////PC0 nsleep, output pin driven low
-   PORTC.DIRSET = PIN0_bm;
-   PORTC.OUTCLR = PIN0_bm;
+   control_stop();
 
-   //PC4 - IN1 - PB6
-     //PC5  - IN2 - PB7
-   //set output , pwm mode
-   PORTC.DIRSET = (PIN4_bm | PIN5_bm);
- 
+   if (runtime.button.button_forward && !runtime.button.button_reverse)
+      ramp_set(speed);
+   else if (runtime.button.button_reverse && !runtime.button.button_forward)
+      ramp_set(-speed);
+   else
+      ramp_set(0);
+}
 
-   
+static void button_update(timer_events_t events){
+   if(BUTTON_FORWARD == runtime.button.button_forward){
+      timer16_enable(&runtime.timer.button_forward, false);
+      timer16_reset(&runtime.timer.button_forward);
+   }else{
+      timer16_enable(&runtime.timer.button_forward, true);
+   }
+   if(BUTTON_REVERSE == runtime.button.button_reverse){
+      timer16_enable(&runtime.timer.button_reverse, false);
+      timer16_reset(&runtime.timer.button_reverse);
+   }
+   else {
+      timer16_enable(&runtime.timer.button_reverse, true);
+   }
+
+   if((events & timer_event(&runtime.timer.button_forward)) && timer16_expired(&runtime.timer.button_forward, true))
+   {
+      runtime.button.button_forward = BUTTON_FORWARD;
+      drive_motor();
+   }
+   if((events & timer_event(&runtime.timer.button_reverse)) && timer16_expired(&runtime.timer.button_reverse, true)){
+      runtime.button.button_reverse = BUTTON_REVERSE;
+      drive_motor();
+   }
 }
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool command_duty(const int32_t* argv)
+{
+   if ((argv[0] < 0) || (argv[0] > 100))
+      return false;
 
-void disable_pwm(){
-   TCA0.SPLIT.CTRLA &= ~TCA_SPLIT_ENABLE_bm;
+   runtime.pwm.duty = argv[0];
+
+   if (runtime.button.button_forward || runtime.button.button_reverse)
+      drive_motor();
+
+   return true;
 }
 
-void forward_pwm_init(bool forward){
-      //You want to read the value from PB6 and then drive forward
-      if(forward){
-      PORTC.OUTCLR = PIN4_bm;
-      ////////////set pwm up
-      //enable split mode
-      TCA0.SPLIT.CTRLD = TCA_SINGLE_SPLITM_bm;
-      //ENABLE HMP1 PC4
-      TCA0.SPLIT.CTRLB = TCA_SPLIT_HCMP1EN_bm;
-      TCA0.SPLIT.CTRLA = (TCA0.SPLIT.CTRLA & ~TCA_SPLIT_CLKSEL_gm) | TCA_SPLIT_CLKSEL_DIV1_gc;
-
-      TCA0.SPLIT.HPER = PWM_HPER;
-      TCA0.SPLIT.HCMP1 = TCA0.SPLIT.HPER / 2;
-      PORTC.OUTSET = PIN0_bm;
-      TCA0.SPLIT.CTRLA |= TCA_SPLIT_ENABLE_bm;
-      
-      //IN2 = 0
-      PORTC.OUTCLR = PIN5_bm;
-
-      }else{
-         //REVERSE
-               PORTC.OUTCLR = PIN5_bm;
-               TCA0.SPLIT.CTRLD = TCA_SINGLE_SPLITM_bm;
-               TCA0.SPLIT.CTRLB = TCA_SPLIT_HCMP2EN_bm;
-               TCA0.SPLIT.CTRLA = (TCA0.SPLIT.CTRLA & ~TCA_SPLIT_CLKSEL_gm) | TCA_SPLIT_CLKSEL_DIV1_gc;
-               TCA0.SPLIT.HPER = PWM_HPER;
-               TCA0.SPLIT.HCMP2 = TCA0.SPLIT.HPER / 2;
-               TCA0.SPLIT.CTRLA |= TCA_SPLIT_ENABLE_bm;
-               //IN1
-               PORTC.OUTSET = PIN0_bm;
-               PORTC.OUTCLR = PIN4_bm;
-      }  
-   
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool command_freq(const int32_t* argv)
+{
+   return (argv[0] > 0) && motor_frequency(argv[0]);
 }
 
-void drive_motor(){
-   //you either drive forwards or reverse depending on the button pressed
-   if(runtime.button.button_forward && !runtime.button.button_reverse){
-      //drive forward
-      disable_pwm();
-      forward_pwm_init(true);
-   
-   }else if(runtime.button.button_reverse && !runtime.button.button_forward){
-      //drive reverse
-      disable_pwm();
-      forward_pwm_init(false);
-   }
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool command_stop(const int32_t* argv)
+{
+   runtime.pwm.duty = 0;
+   control_stop();
+   ramp_halt();
+   motor_coast();
+
+   return true;
+}
 
-   if(!runtime.button.button_forward && !runtime.button.button_reverse){
-      disable_pwm();
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool command_speed(const int32_t* argv)
+{
+   if ((argv[0] < -MOTOR_SPEED_MAX) || (argv[0] > MOTOR_SPEED_MAX))
+      return false;
 
-   }
+   control_stop();
+   ramp_set(argv[0]);
+
+   return true;
 }
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool command_coast(const int32_t* argv)
+{
+   control_stop();
+   ramp_halt();
+   motor_coast();
 
+   return true;
+}
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool command_brake(const int32_t* argv)
+{
+   control_stop();
+   ramp_halt();
+   motor_brake();
 
+   return true;
+}
 
-static void button_update(){
-   if(BUTTON_FORWARD == runtime.button.button_forward){
-      timer_enable(&runtime.timer.button_forward, false);
-      timer_reset(&runtime.timer.button_forward);
-   }else{
-      timer_enable(&runtime.timer.button_forward, true);
-   }
-   if(BUTTON_REVERSE == runtime.button.button_reverse){
-      timer_enable(&runtime.timer.button_reverse, false);
-      timer_reset(&runtime.timer.button_reverse);
-   }
-   else {
-      timer_enable(&runtime.timer.button_reverse, true);
-   }
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool command_track(const int32_t* argv)
+{
+   // the loop takes over from wherever the ramp left the motor
+   ramp_halt();
+   control_set(argv[0]);
 
-   if(timer_expired(&runtime.timer.button_forward, true))
-   {
-      runtime.button.button_forward = BUTTON_FORWARD;
+   return true;
+}
 
-   }
-   if(timer_expired(&runtime.timer.button_reverse, true)){
-      runtime.button.button_reverse = BUTTON_REVERSE;
-   }
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool command_stats(const int32_t* argv)
+{
+   uart_stats_t uart;
+
+   uart_stats(&uart, false);
+
+   log_printf("rx bufovf %u, ferr %u, perr %u, overrun %u, peak %u/%u\n",
+      (unsigned) uart.bufovf, (unsigned) uart.ferr, (unsigned) uart.perr, (unsigned) uart.overrun,
+      uart.rx_peak, UART_RX_BUFFER_SIZE);
+   log_printf("tx dropped %u, peak %u/%u\n", (unsigned) uart.tx_dropped, uart.tx_peak, UART_TX_BUFFER_SIZE);
+   log_printf("timer drops %u, jitter %u us\n", (unsigned) timer_deferred_drops(false), timer_usec_jitter(false));
+   log_printf("velocity %d of %d edges/s\n", control_velocity(), control_setpoint());
+
+   return true;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static const command_t commands[] =
+{
+   { "duty", 1, command_duty },
+   { "freq", 1, command_freq },
+   { "stop", 0, command_stop },
+   { "stats", 0, command_stats },
+   { "speed", 1, command_speed },
+   { "coast", 0, command_coast },
+   { "brake", 0, command_brake },
+   { "track", 1, command_track },
+};
+
+#ifdef TELEMETRY_PERIOD
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void telemetry_update()
+{
+   telemetry_state_t state;
+
+   state.direction = 0;
+
+   if (motor_state() == MOTOR_FORWARD)
+      state.direction = 1;
+   else if (motor_state() == MOTOR_REVERSE)
+      state.direction = -1;
+
+   state.duty = (uint16_t) motor_duty() * 255 / 100;
+
+   state.buttons = (runtime.button.button_forward ? 0x01 : 0) | (runtime.button.button_reverse ? 0x02 : 0);
+   state.timer_drops = timer_deferred_drops(false);
+   state.timer_jitter = timer_usec_jitter(false);
+   state.uart_dropped = uart_tx_dropped(false);
+   state.uart_errors = uart_rx_errors(false);
+
+   telemetry_send(&state);
 }
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static uint8_t sleep_mode()
+{
+   // standby stops the peripheral clock, so TX, the PWM and TCB0 must all be idle
+   if (uart_tx_length() > 0)
+      return SLEEP_MODE_IDLE;
+
+   if (TCA0.SPLIT.CTRLA & TCA_SPLIT_ENABLE_bm)
+      return SLEEP_MODE_IDLE;
+
+   if (timer_usec_active())
+      return SLEEP_MODE_IDLE;
+
+   return SLEEP_MODE_STANDBY;
+}
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
 int main()
 {
+   bool baud;
+
    sys_init();
-   uart_init(9600);
+
+   // a rate the clock cannot make within tolerance falls back to 9600, which every F_CPU here hits exactly
+   baud = uart_init(UART_BAUD);
+
+   if (!baud)
+      uart_init(9600UL);
+
    timer_init();
    motor_init();
+   ramp_init();
+   encoder_init();
+   control_init();
+
+   PORTB.DIRCLR = (PIN6_bm | PIN7_bm);
 
     _delay_ms(100);
 
-   printf("\n!BOOT %02X\n", RSTCTRL.RSTFR);
+   log_printf("\n!BOOT %02X\n", RSTCTRL.RSTFR);
    RSTCTRL.RSTFR = RSTCTRL.RSTFR;
 
+   if (!baud)
+      log_printf("!BAUD %lu\n", UART_BAUD);
+
    timer_add(&runtime.timer.main, TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, 1000, NULL);
-   timer_add(&runtime.timer.button_forward, 0, BUTTON_TIMER_DEBOUNCE, NULL);
-   timer_add(&runtime.timer.button_reverse, 0, BUTTON_TIMER_DEBOUNCE, NULL);
+   timer16_add(&runtime.timer.button_forward, 0, BUTTON_TIMER_DEBOUNCE, NULL);
+   timer16_add(&runtime.timer.button_reverse, 0, BUTTON_TIMER_DEBOUNCE, NULL);
+#ifdef TELEMETRY_PERIOD
+   timer16_add(&runtime.timer.telemetry, TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, TELEMETRY_PERIOD, NULL);
+#endif
    runtime.button.button_forward = false;
    runtime.button.button_reverse = false;
+   runtime.pwm.duty = 50;
 
    sei();
 
    for (;;)
    {
-      timer_update();
-      button_update();
-      drive_motor();
+      timer_events_t events = timer_update();
 
-      if (timer_expired(&runtime.timer.main, true))
-         printf("Hello, World! ;)");
+#ifdef BUS_ADDRESS
+      bus_update(commands, SIZEOF_ARRAY(commands));
+#else
+      command_update(commands, SIZEOF_ARRAY(commands));
+#endif
+      button_update(events);
+
+      if (events & timer_event(&runtime.timer.main))
+      {
+         timer_expired(&runtime.timer.main, true);
+         log_printf("Hello, World! ;)");
+      }
+
+      console_flush();
+
+#ifdef TELEMETRY_PERIOD
+      if (events & timer_event(&runtime.timer.telemetry))
+         telemetry_update();
+#endif
 
+      // sei() takes effect after sleep_cpu(), so an interrupt after the check still wakes the CPU
+      cli();
+      set_sleep_mode(sleep_mode());
       sleep_enable();
+      sei();
       sleep_cpu();
       sleep_disable();
    }
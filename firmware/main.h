@@ -16,7 +16,35 @@
  *******************************************************************************************************************/
 #define UART_ALTERNATE_PINS
 #define UART_TX_BUFFER_SIZE 32
-#define UART_RX_BUFFER_SIZE 8
+#define UART_RX_BUFFER_SIZE 64
+#define UART_TX_POLICY      UART_TX_DROP_NEWEST
+#define UART_RX_WAKEUP
+//#define UART_RS485
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+//#define BUS_ADDRESS 0x01
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define MOTOR_PWM_FREQ 50000UL
+//#define RAMP_PROFILE  RAMP_SCURVE
+//#define CONTROL_KP    256
+//#define CONTROL_KI    32
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+//#define TELEMETRY_PERIOD 2
+//#define LOG_TOKENIZED
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+//#define TIMER_TICKLESS
+//#define TIMER_WHEEL
 
 /*******************************************************************************************************************
  *
@@ -33,6 +61,11 @@ void console_tx(int c);
  *
  ********************************************************************************************************************/
 int console_rx();
+
+/********************************************************************************************************************
+ *
+ ********************************************************************************************************************/
+void console_flush();
 #endif
 
 #endif
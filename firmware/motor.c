@@ -0,0 +1,319 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "main.h"
+#include "motor.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define MOTOR_NSLEEP PIN0_bm
+#define MOTOR_IN1    PIN4_bm
+#define MOTOR_IN2    PIN5_bm
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef MOTOR_PWM_FREQ
+#define MOTOR_PWM_FREQ 50000UL
+#endif
+
+// WO4 and WO5 only exist in split mode, where the period is 8 bit, so the smallest prescaler that fits is used
+#if (F_CPU / MOTOR_PWM_FREQ) <= 256
+#define MOTOR_PWM_DIV    1
+#define MOTOR_PWM_CLKSEL TCA_SPLIT_CLKSEL_DIV1_gc
+#elif (F_CPU / MOTOR_PWM_FREQ) <= 512
+#define MOTOR_PWM_DIV    2
+#define MOTOR_PWM_CLKSEL TCA_SPLIT_CLKSEL_DIV2_gc
+#elif (F_CPU / MOTOR_PWM_FREQ) <= 1024
+#define MOTOR_PWM_DIV    4
+#define MOTOR_PWM_CLKSEL TCA_SPLIT_CLKSEL_DIV4_gc
+#elif (F_CPU / MOTOR_PWM_FREQ) <= 2048
+#define MOTOR_PWM_DIV    8
+#define MOTOR_PWM_CLKSEL TCA_SPLIT_CLKSEL_DIV8_gc
+#elif (F_CPU / MOTOR_PWM_FREQ) <= 4096
+#define MOTOR_PWM_DIV    16
+#define MOTOR_PWM_CLKSEL TCA_SPLIT_CLKSEL_DIV16_gc
+#elif (F_CPU / MOTOR_PWM_FREQ) <= 16384
+#define MOTOR_PWM_DIV    64
+#define MOTOR_PWM_CLKSEL TCA_SPLIT_CLKSEL_DIV64_gc
+#elif (F_CPU / MOTOR_PWM_FREQ) <= 65536
+#define MOTOR_PWM_DIV    256
+#define MOTOR_PWM_CLKSEL TCA_SPLIT_CLKSEL_DIV256_gc
+#elif (F_CPU / MOTOR_PWM_FREQ) <= 262144
+#define MOTOR_PWM_DIV    1024
+#define MOTOR_PWM_CLKSEL TCA_SPLIT_CLKSEL_DIV1024_gc
+#else
+#error "MOTOR_PWM_FREQ is too low for TCA0"
+#endif
+
+#define MOTOR_PWM_CLOCK  (F_CPU / MOTOR_PWM_DIV)
+#define MOTOR_PWM_PERIOD ((MOTOR_PWM_CLOCK + MOTOR_PWM_FREQ / 2) / MOTOR_PWM_FREQ - 1)
+
+// motor_drive() takes the duty in percent, fewer counts per period would make some of the steps equal
+#if MOTOR_PWM_PERIOD < 100
+#error "MOTOR_PWM_FREQ leaves less than 1% duty resolution"
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   motor_state_t state;
+   uint16_t level;
+   volatile uint8_t period;
+   volatile uint8_t compare;
+   volatile bool reload;
+
+} motor;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _motor_load()
+{
+   if (motor.reload)
+   {
+      TCA0.SPLIT.HPER = motor.period;
+      motor.reload = false;
+   }
+
+   // only the channel of the current direction is in use
+   if (motor.state == MOTOR_FORWARD)
+      TCA0.SPLIT.HCMP1 = motor.compare;
+   else if (motor.state == MOTOR_REVERSE)
+      TCA0.SPLIT.HCMP2 = motor.compare;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+ISR(TCA0_HUNF_vect)
+{
+   _motor_load();
+
+   TCA0.SPLIT.INTCTRL = 0;
+   TCA0.SPLIT.INTFLAGS = TCA_SPLIT_HUNF_bm;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _motor_compare()
+{
+   // level is Q15, the product stays below 2^23
+   motor.compare = ((uint32_t) motor.period * motor.level) >> 15;
+
+   // split mode has no buffer registers, so a running timer takes the new values at the end of its period
+   if (TCA0.SPLIT.CTRLA & TCA_SPLIT_ENABLE_bm)
+   {
+      TCA0.SPLIT.INTFLAGS = TCA_SPLIT_HUNF_bm;
+      TCA0.SPLIT.INTCTRL = TCA_SPLIT_HUNF_bm;
+   }
+   else
+   {
+      _motor_load();
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _motor_output(motor_state_t state)
+{
+   // every transition passes through both inputs low, so a PWM and a static high never overlap on the bridge
+   TCA0.SPLIT.CTRLA &= ~TCA_SPLIT_ENABLE_bm;
+   TCA0.SPLIT.INTCTRL = 0;
+   TCA0.SPLIT.CTRLB = 0;
+   PORTC.OUTCLR = MOTOR_IN1 | MOTOR_IN2;
+
+   motor.state = state;
+
+   switch (state)
+   {
+      case MOTOR_FORWARD:
+         _motor_compare();
+         TCA0.SPLIT.CTRLB = TCA_SPLIT_HCMP1EN_bm;
+         PORTC.OUTSET = MOTOR_NSLEEP;
+         TCA0.SPLIT.CTRLA |= TCA_SPLIT_ENABLE_bm;
+         break;
+
+      case MOTOR_REVERSE:
+         _motor_compare();
+         TCA0.SPLIT.CTRLB = TCA_SPLIT_HCMP2EN_bm;
+         PORTC.OUTSET = MOTOR_NSLEEP;
+         TCA0.SPLIT.CTRLA |= TCA_SPLIT_ENABLE_bm;
+         break;
+
+      case MOTOR_BRAKE:
+         // DRV8701 with both inputs high shorts the motor through the low side
+         PORTC.OUTSET = MOTOR_NSLEEP | MOTOR_IN1 | MOTOR_IN2;
+         break;
+
+      default:
+         // asleep the bridge outputs are high impedance, which also lets the motor coast
+         PORTC.OUTCLR = MOTOR_NSLEEP;
+         break;
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _motor_set(motor_state_t state, uint16_t level)
+{
+   // a fault holds the bridge off until it is cleared explicitly
+   if (motor.state == MOTOR_FAULT)
+      return;
+
+   if ((state != MOTOR_FORWARD) && (state != MOTOR_REVERSE))
+      level = 0;
+   else if (level == 0)
+      state = MOTOR_COAST;
+
+   // TCA0 is only touched when something changes, the caller may repeat the same request every loop
+   if (state != motor.state)
+   {
+      motor.level = level;
+      _motor_output(state);
+   }
+   else if (level != motor.level)
+   {
+      motor.level = level;
+      _motor_compare();
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_drive(motor_state_t state, uint8_t duty)
+{
+   if (duty > 100)
+      duty = 100;
+
+   _motor_set(state, (uint16_t) (((uint32_t) duty * MOTOR_SPEED_MAX + 50) / 100));
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_set_speed(int16_t speed)
+{
+   if (speed > 0)
+      _motor_set(MOTOR_FORWARD, speed);
+   else if (speed < -MOTOR_SPEED_MAX)
+      _motor_set(MOTOR_REVERSE, MOTOR_SPEED_MAX);
+   else
+      _motor_set(MOTOR_REVERSE, -speed);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int16_t motor_speed()
+{
+   if (motor.state == MOTOR_FORWARD)
+      return motor.level;
+
+   if (motor.state == MOTOR_REVERSE)
+      return -(int16_t) motor.level;
+
+   return 0;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_coast()
+{
+   _motor_set(MOTOR_COAST, 0);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_brake()
+{
+   _motor_set(MOTOR_BRAKE, 0);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool motor_frequency(uint32_t frequency)
+{
+   uint32_t period;
+
+   if (frequency == 0)
+      return false;
+
+   // the prescaler stays as chosen for MOTOR_PWM_FREQ, only the period follows
+   period = (MOTOR_PWM_CLOCK + frequency / 2) / frequency - 1;
+
+   if ((period < 100) || (period > 0xFF))
+      return false;
+
+   if (period != motor.period)
+   {
+      motor.period = period;
+      motor.reload = true;
+      _motor_compare();
+   }
+
+   return true;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+motor_state_t motor_state()
+{
+   return motor.state;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint8_t motor_duty()
+{
+   return ((uint32_t) motor.level * 100 + MOTOR_SPEED_MAX / 2) / MOTOR_SPEED_MAX;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_fault_clear()
+{
+   if (motor.state == MOTOR_FAULT)
+      _motor_output(MOTOR_COAST);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_init()
+{
+   PORTC.OUTCLR = MOTOR_NSLEEP | MOTOR_IN1 | MOTOR_IN2;
+   PORTC.DIRSET = MOTOR_NSLEEP | MOTOR_IN1 | MOTOR_IN2;
+
+   // WO4 and WO5 default to PA4 and PA5
+   PORTMUX.CTRLC |= PORTMUX_TCA04_bm | PORTMUX_TCA05_bm;
+
+   TCA0.SPLIT.CTRLA = 0;
+   TCA0.SPLIT.CTRLD = TCA_SINGLE_SPLITM_bm;
+   TCA0.SPLIT.CTRLA = MOTOR_PWM_CLKSEL;
+
+   motor.period = MOTOR_PWM_PERIOD;
+   motor.level = 0;
+   motor.compare = 0;
+   motor.reload = true;
+
+   _motor_output(MOTOR_COAST);
+}
@@ -0,0 +1,79 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef MOTOR_H
+#define MOTOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define MOTOR_SPEED_MAX 0x7FFF
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+typedef enum
+{
+   MOTOR_COAST,
+   MOTOR_FORWARD,
+   MOTOR_REVERSE,
+   MOTOR_BRAKE,
+   MOTOR_FAULT
+
+} motor_state_t;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_drive(motor_state_t state, uint8_t duty);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_set_speed(int16_t speed);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int16_t motor_speed();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_coast();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_brake();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool motor_frequency(uint32_t frequency);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+motor_state_t motor_state();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint8_t motor_duty();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_fault_clear();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void motor_init();
+
+#endif
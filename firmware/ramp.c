@@ -0,0 +1,240 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "main.h"
+#include "motor.h"
+#include "ramp.h"
+#include "timer.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef RAMP_PERIOD
+#define RAMP_PERIOD 1
+#endif
+
+#ifndef RAMP_PROFILE
+#define RAMP_PROFILE RAMP_TRAPEZOID
+#endif
+
+#ifndef RAMP_ACCELERATION
+#define RAMP_ACCELERATION 64
+#endif
+
+#ifndef RAMP_JERK
+#define RAMP_JERK 2
+#endif
+
+#ifndef RAMP_DWELL
+#define RAMP_DWELL 100
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   timer_t timer;
+   ramp_profile_t profile;
+   uint16_t acceleration;
+   uint16_t jerk;
+   uint16_t dwell;
+
+   int16_t target;
+   int16_t speed;
+   int32_t rate;
+   uint16_t wait;
+   bool complete;
+
+} ramp;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static int16_t _ramp_step(int16_t target)
+{
+   // speed is Q15 and changes by rate every tick, an S-curve also limits how fast rate changes
+   int32_t distance = (int32_t) target - ramp.speed;
+   uint16_t remaining = (distance < 0) ? -distance : distance;
+   int32_t limit = (distance < 0) ? -(int32_t) ramp.acceleration : ramp.acceleration;
+   int32_t rate = ramp.rate;
+   int32_t speed;
+
+   if (remaining == 0)
+   {
+      ramp.rate = 0;
+      return target;
+   }
+
+   if (ramp.profile == RAMP_SCURVE)
+   {
+      int32_t jerk = (distance < 0) ? -(int32_t) ramp.jerk : ramp.jerk;
+      uint32_t magnitude = (rate < 0) ? -rate : rate;
+      bool toward = (rate != 0) && ((rate < 0) == (distance < 0));
+
+      // winding the rate down by jerk per tick covers rate * (rate + jerk) / (2 * jerk) on the way
+      if (toward && ((2UL * ramp.jerk * remaining) <= (magnitude * (magnitude + ramp.jerk))))
+         rate = (magnitude > ramp.jerk) ? rate - jerk : jerk;
+      else
+         rate += jerk;
+
+      if ((rate > 0) && (rate > limit) && (limit > 0))
+         rate = limit;
+      else if ((rate < 0) && (rate < limit) && (limit < 0))
+         rate = limit;
+   }
+   else
+   {
+      rate = limit;
+   }
+
+   // the last step lands on the target instead of passing it
+   if (((rate < 0) == (distance < 0)) && ((uint32_t) ((rate < 0) ? -rate : rate) >= remaining))
+   {
+      ramp.rate = 0;
+      return target;
+   }
+
+   ramp.rate = rate;
+   speed = (int32_t) ramp.speed + rate;
+
+   if (speed > MOTOR_SPEED_MAX)
+      speed = MOTOR_SPEED_MAX;
+   else if (speed < -MOTOR_SPEED_MAX)
+      speed = -MOTOR_SPEED_MAX;
+
+   return speed;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _ramp_update(timer_t* timer)
+{
+   int16_t target = ramp.target;
+
+   // a tick queued before ramp_halt() must not turn the caller's brake back into a coast
+   if (!timer_enabled(timer))
+      return;
+
+   if (ramp.wait > 0)
+   {
+      ramp.wait--;
+      return;
+   }
+
+   // a reversal runs down to zero first and stays there for the dwell time
+   if (((ramp.speed > 0) && (target < 0)) || ((ramp.speed < 0) && (target > 0)))
+      target = 0;
+
+   ramp.speed = _ramp_step(target);
+   motor_set_speed(ramp.speed);
+
+   if (ramp.speed != ramp.target)
+   {
+      if ((ramp.speed == 0) && (ramp.rate == 0))
+         ramp.wait = (ramp.dwell + RAMP_PERIOD - 1) / RAMP_PERIOD;
+   }
+   else
+   {
+      ramp.complete = true;
+      timer_enable(&ramp.timer, false);
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_config(ramp_profile_t profile, uint16_t acceleration, uint16_t jerk, uint16_t dwell)
+{
+   ramp.profile = profile;
+   ramp.acceleration = (acceleration == 0) ? 1 : (acceleration > MOTOR_SPEED_MAX) ? MOTOR_SPEED_MAX : acceleration;
+   ramp.jerk = (jerk == 0) ? 1 : (jerk > MOTOR_SPEED_MAX) ? MOTOR_SPEED_MAX : jerk;
+   ramp.dwell = dwell;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_set(int16_t target)
+{
+   if (target < -MOTOR_SPEED_MAX)
+      target = -MOTOR_SPEED_MAX;
+
+   if (target == ramp.target)
+      return;
+
+   ramp.target = target;
+   ramp.complete = false;
+
+   if (!timer_enabled(&ramp.timer))
+   {
+      timer_reset(&ramp.timer);
+      timer_enable(&ramp.timer, true);
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_halt()
+{
+   // the caller decides between coast and brake, the ramp only forgets where it was
+   timer_enable(&ramp.timer, false);
+
+   ramp.target = 0;
+   ramp.speed = 0;
+   ramp.rate = 0;
+   ramp.wait = 0;
+   ramp.complete = true;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_sync()
+{
+   // after something else drove the motor the ramp continues from its current speed instead of from zero
+   timer_enable(&ramp.timer, false);
+
+   ramp.speed = motor_speed();
+   ramp.target = ramp.speed;
+   ramp.rate = 0;
+   ramp.wait = 0;
+   ramp.complete = true;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int16_t ramp_target()
+{
+   return ramp.target;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool ramp_complete(bool clear)
+{
+   bool complete = ramp.complete;
+
+   if (clear)
+      ramp.complete = false;
+
+   return complete;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_init()
+{
+   ramp_config(RAMP_PROFILE, RAMP_ACCELERATION, RAMP_JERK, RAMP_DWELL);
+
+   // deferred, so motor_set_speed() runs from timer_update() like every other motor call
+   timer_add(&ramp.timer, TIMER_FLAG_PERIODIC | TIMER_FLAG_ASYNC | TIMER_FLAG_DEFER, RAMP_PERIOD, _ramp_update);
+}
@@ -0,0 +1,56 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef RAMP_H
+#define RAMP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+typedef enum
+{
+   RAMP_TRAPEZOID,
+   RAMP_SCURVE
+
+} ramp_profile_t;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_config(ramp_profile_t profile, uint16_t acceleration, uint16_t jerk, uint16_t dwell);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_set(int16_t target);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_halt();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int16_t ramp_target();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_sync();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool ramp_complete(bool clear);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void ramp_init();
+
+#endif
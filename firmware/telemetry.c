@@ -0,0 +1,55 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "frame.h"
+#include "main.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   uint8_t buffer[FRAME_SIZE(sizeof(telemetry_state_t))];
+   uint8_t sequence;
+   size_t drops;
+
+} telemetry;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void telemetry_send(telemetry_state_t* state)
+{
+   size_t length;
+
+   state->type = TELEMETRY_RECORD_STATE;
+   state->sequence = telemetry.sequence++;
+   state->time = (uint16_t) timer_now_ms();
+
+   length = frame_encode(telemetry.buffer, state, sizeof(*state));
+
+   // a record is sent whole or not at all, the sequence number shows the gap to the host
+   if (uart_tx_space() >= length)
+      uart_write(telemetry.buffer, length);
+   else
+      telemetry.drops++;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t telemetry_drops(bool reset)
+{
+   size_t drops = telemetry.drops;
+
+   if (reset)
+      telemetry.drops = 0;
+
+   return drops;
+}
@@ -0,0 +1,44 @@
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define TELEMETRY_RECORD_STATE 0x01
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+typedef struct __attribute__((packed))
+{
+   uint8_t type;
+   uint8_t sequence;
+   uint16_t time;
+   int8_t direction;
+   uint8_t duty;
+   uint8_t buttons;
+   uint8_t timer_drops;
+   uint16_t timer_jitter;
+   uint16_t uart_dropped;
+   uint16_t uart_errors;
+
+} telemetry_state_t;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void telemetry_send(telemetry_state_t* state);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t telemetry_drops(bool reset);
+
+#endif
@@ -4,6 +4,7 @@
 #include <avr/interrupt.h>
 #include <avr/io.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <util/atomic.h>
 #include "main.h"
 #include "timer.h"
@@ -15,134 +16,1460 @@
 #define TIMER_MSEC 1
 #endif
 
+// RTC counts per tick; ticks are converted to exact milliseconds by a fractional accumulator
+#define TIMER_COUNTS (32768UL * TIMER_MSEC / 1000)
+
+#if (TIMER_COUNTS < 1) || (TIMER_COUNTS > 0x10000)
+#error "TIMER_MSEC out of range"
+#endif
+
+#ifdef TIMER_TICKLESS
+#ifndef TIMER_TICKLESS_MAX
+#define TIMER_TICKLESS_MAX 0x4000
+#endif
+#define TIMER_TICKLESS_LEAD 3
+#endif
+
+// TCB0 runs from CLK_PER / 2, microsecond timers are limited to one 16-bit period per interrupt
+#define TIMER_USEC_COUNTS (F_CPU / 2000000UL)
+#define TIMER_USEC_SHOT   (0xFFFF / TIMER_USEC_COUNTS)
+
+#if TIMER_USEC_COUNTS < 1
+#error "F_CPU too low for microsecond timers"
+#endif
+
+#ifndef TIMER_USEC_MIN
+#define TIMER_USEC_MIN 20
+#endif
+
+#ifndef TIMER_DEFER_SIZE
+#define TIMER_DEFER_SIZE 8
+#endif
+
+#if (TIMER_DEFER_SIZE & (TIMER_DEFER_SIZE - 1)) != 0
+#error "TIMER_DEFER_SIZE must be a power of two"
+#endif
+
+#ifdef TIMER_WHEEL
+#define TIMER_WHEEL_BITS   4
+#define TIMER_WHEEL_SLOTS  (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SPAN   ((1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static timer_t* timers[3];
+static timer16_t* timers16[2];
+static volatile uint32_t ticks;
+static volatile uint64_t epoch;
+static uint16_t fraction;
+static uint32_t lag[3];
+static uint16_t lag16;
+static uint16_t shot;
+static uint16_t jitter;
+#ifdef TIMER_TICKLESS
+static uint16_t stamp;
+static uint16_t compare;
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static volatile timer_events_t events;
+static uint8_t assigned;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   timer_t* volatile buffer[TIMER_DEFER_SIZE];
+   volatile uint8_t head;
+   volatile uint8_t tail;
+   uint8_t peak;
+   size_t drops;
+   timer_t* running;
+
+} deferred;
+
+#ifdef TIMER_WHEEL
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static struct
+{
+   timer_t* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+   uint32_t now;
+   uint16_t count;
+
+} wheel;
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static timer_t** _timer_list(timer_t* timer)
+{
+   return (timer->flags & TIMER_FLAG_USEC) ? &timers[2] : &timers[0];
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static uint16_t _timer_usec_elapsed()
+{
+   uint8_t flags = TCB0.INTFLAGS;
+   uint16_t counts = TCB0.CNT;
+
+   // a compare match not yet serviced means the whole shot has elapsed as well
+   if (((flags & TCB_CAPT_bm) == 0) && (TCB0.INTFLAGS & TCB_CAPT_bm))
+   {
+      flags = TCB_CAPT_bm;
+      counts = TCB0.CNT;
+   }
+
+   return counts / TIMER_USEC_COUNTS + ((flags & TCB_CAPT_bm) ? shot : 0);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static uint32_t _timer_pending(timer_t** list)
+{
+   // time since the base of the queue, which only moves when its interrupt runs
+   uint32_t value = lag[list - timers];
+
+   if (list == &timers[2])
+      value += _timer_usec_elapsed();
+#ifdef TIMER_TICKLESS
+   else
+      value += ((uint32_t) (uint16_t) (RTC.CNT - stamp) * 1000 + fraction) >> 15;
+#endif
+
+   return value;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static timer_events_t _timer_expired(timer_t* timer)
+{
+   if (timer->flags & TIMER_FLAG_EXPIRED)
+      timer->flags |= TIMER_FLAG_OVERFLOW;
+   else
+      timer->flags |= TIMER_FLAG_EXPIRED;
+
+   // the caller collects the bits and merges them into events where the interrupts cannot interfere
+   return timer_event(timer);
+}
+
+#ifndef TIMER_WHEEL
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static timer_events_t _timer_update(timer_t* list, uint32_t value)
+{
+   timer_events_t fired = 0;
+
+   while (list != NULL)
+   {
+      if ((list->flags & TIMER_FLAG_ENABLED) && (list->value.reset > 0))
+      {
+         if (list->flags & TIMER_FLAG_COUNTUP)
+         {
+            list->value.current += value;
+
+            if (list->value.current >= list->value.reset)
+            {
+               // periodic timers keep the overshoot so they don't drift when ticks are batched
+               if (list->flags & TIMER_FLAG_PERIODIC)
+                  list->value.current = (list->value.current - list->value.reset) % list->value.reset;
+               else
+                  list->flags &= ~TIMER_FLAG_ENABLED;
+
+               fired |= _timer_expired(list);
+
+               if (list->fx != NULL)
+               {
+                  list->flags |= TIMER_FLAG_CALLBACK;
+                  list->fx(list);
+                  list->flags &= ~TIMER_FLAG_CALLBACK;
+               }
+            }
+         }
+         else
+         {
+            if (list->value.current <= value)
+            {
+               if (list->flags & TIMER_FLAG_PERIODIC)
+                  list->value.current = list->value.reset - ((value - list->value.current) % list->value.reset);
+               else
+                  list->flags &= ~TIMER_FLAG_ENABLED;
+
+               fired |= _timer_expired(list);
+
+               if (list->fx != NULL)
+               {
+                  list->flags |= TIMER_FLAG_CALLBACK;
+                  list->fx(list);
+                  list->flags &= ~TIMER_FLAG_CALLBACK;
+               }
+            }
+            else
+            {
+               list->value.current -= value;
+            }
+         }
+      }
+
+      list = list->next;
+   }
+
+   return fired;
+}
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static timer_events_t _timer16_update(timer16_t* list, uint16_t value)
+{
+   timer_events_t fired = 0;
+
+   // current always counts down, countup timers are converted on access
+   while (list != NULL)
+   {
+      if ((list->flags & TIMER_FLAG_ENABLED) && (list->value.reset > 0))
+      {
+         if (list->value.current <= value)
+         {
+            if (list->flags & TIMER_FLAG_PERIODIC)
+            {
+               list->value.current = list->value.reset - ((value - list->value.current) % list->value.reset);
+            }
+            else
+            {
+               list->value.current = 0;
+               list->flags &= ~TIMER_FLAG_ENABLED;
+            }
+
+            if (list->flags & TIMER_FLAG_EXPIRED)
+               list->flags |= TIMER_FLAG_OVERFLOW;
+            else
+               list->flags |= TIMER_FLAG_EXPIRED;
+
+            fired |= timer_event(list);
+
+            if (list->fx != NULL)
+            {
+               list->flags |= TIMER_FLAG_CALLBACK;
+               list->fx(list);
+               list->flags &= ~TIMER_FLAG_CALLBACK;
+            }
+         }
+         else
+         {
+            list->value.current -= value;
+         }
+      }
+
+      list = list->next;
+   }
+
+   return fired;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static uint16_t _timer16_pending()
+{
+   // like _timer_pending(), the async queue of timer16_t has its own base
+   uint32_t value = lag16;
+
+#ifdef TIMER_TICKLESS
+   value += ((uint32_t) (uint16_t) (RTC.CNT - stamp) * 1000 + fraction) >> 15;
+#endif
+
+   return (value < 0xFFFF) ? value : 0xFFFF;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer16_link(timer16_t** list, timer16_t* timer, uint16_t value)
+{
+   // the same delta queue as for timer_t, with 16-bit deltas
+   while ((*list != NULL) && ((*list)->value.current <= value))
+   {
+      value -= (*list)->value.current;
+      list = &(*list)->next;
+   }
+
+   if (*list != NULL)
+      (*list)->value.current -= value;
+
+   timer->value.current = value;
+   timer->next = *list;
+   timer->flags |= TIMER_FLAG_QUEUED;
+   *list = timer;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static uint32_t _timer16_unlink(timer16_t** list, timer16_t* timer)
+{
+   uint32_t value = 0;
+
+   while (*list != NULL)
+   {
+      value += (*list)->value.current;
+
+      if (*list == timer)
+      {
+         *list = timer->next;
+
+         if (*list != NULL)
+            (*list)->value.current += timer->value.current;
+
+         break;
+      }
+
+      list = &(*list)->next;
+   }
+
+   timer->flags &= ~TIMER_FLAG_QUEUED;
+
+   return value;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool _timer16_remove(timer16_t** list, timer16_t* timer)
+{
+   for (; *list != NULL; list = &(*list)->next)
+   {
+      if (*list == timer)
+      {
+         *list = timer->next;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer16_attach(timer16_t* timer)
+{
+   uint16_t pending;
+   uint16_t value;
+
+   if ((timer->flags & (TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED)) != (TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED))
+      return;
+
+   if (timer->value.reset == 0)
+      return;
+
+   pending = _timer16_pending();
+   value = timer->value.current;
+
+   // a remaining time that cannot be rebased within 16 bits is kept from the last tick instead
+   if (((uint32_t) value + pending) <= 0xFFFF)
+      value += pending;
+
+   _timer16_link(&timers16[0], timer, value);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer16_detach(timer16_t* timer)
+{
+   uint32_t value;
+   uint16_t pending;
+
+   if ((timer->flags & TIMER_FLAG_QUEUED) == 0)
+      return;
+
+   value = _timer16_unlink(&timers16[0], timer);
+   pending = _timer16_pending();
+
+   timer->value.current = (value > pending) ? (value - pending) : 0;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer16_tick(timer16_t** list, uint32_t value)
+{
+   timer_events_t fired = 0;
+   timer16_t* timer;
+
+   while (((timer = *list) != NULL) && (timer->value.current <= value))
+   {
+      value -= timer->value.current;
+      lag16 = value;
+
+      *list = timer->next;
+      timer->flags &= ~TIMER_FLAG_QUEUED;
+
+      if (timer->flags & TIMER_FLAG_PERIODIC)
+      {
+         _timer16_link(list, timer, timer->value.reset);
+      }
+      else
+      {
+         timer->value.current = 0;
+         timer->flags &= ~TIMER_FLAG_ENABLED;
+      }
+
+      if (timer->flags & TIMER_FLAG_EXPIRED)
+         timer->flags |= TIMER_FLAG_OVERFLOW;
+      else
+         timer->flags |= TIMER_FLAG_EXPIRED;
+
+      fired |= timer_event(timer);
+
+      if (timer->fx != NULL)
+      {
+         timer->flags |= TIMER_FLAG_CALLBACK;
+         timer->fx(timer);
+         timer->flags &= ~TIMER_FLAG_CALLBACK;
+      }
+   }
+
+   if (timer != NULL)
+      timer->value.current -= value;
+
+   lag16 = 0;
+   events |= fired;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool _timer_remove(timer_t** list, timer_t* timer)
+{
+   for (; *list != NULL; list = &(*list)->next)
+   {
+      if (*list == timer)
+      {
+         *list = timer->next;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+#ifdef TIMER_WHEEL
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_wheel_link(timer_t* timer)
+{
+   // value.current holds the absolute expiry while the timer is on the wheel
+   uint32_t value = timer->value.current - wheel.now;
+   uint8_t level = 0;
+   uint8_t slot;
+
+   // beyond the span the timer is parked in the top level and reinserted when that slot cascades
+   if (value > TIMER_WHEEL_SPAN)
+      value = TIMER_WHEEL_SPAN;
+
+   while ((level < TIMER_WHEEL_LEVELS - 1) && (value >= (1UL << (TIMER_WHEEL_BITS * (level + 1)))))
+      level++;
+
+   slot = ((wheel.now + value) >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+
+   timer->next = wheel.slots[level][slot];
+   timer->flags |= TIMER_FLAG_QUEUED;
+   wheel.slots[level][slot] = timer;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_wheel_unlink(timer_t* timer)
+{
+   uint8_t level;
+   uint8_t slot;
+
+   for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+   {
+      slot = (timer->value.current >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+
+      if (_timer_remove(&wheel.slots[level][slot], timer))
+         break;
+   }
+
+   // only timers parked beyond the span are not in the slot of their expiry
+   for (slot = 0; (level == TIMER_WHEEL_LEVELS) && (slot < TIMER_WHEEL_SLOTS); slot++)
+   {
+      if (_timer_remove(&wheel.slots[TIMER_WHEEL_LEVELS - 1][slot], timer))
+         break;
+   }
+
+   timer->flags &= ~TIMER_FLAG_QUEUED;
+   wheel.count--;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static timer_events_t _timer_wheel_update(uint32_t value)
+{
+   uint32_t target = wheel.now + value;
+   timer_events_t fired = 0;
+   timer_t* timer;
+   uint8_t level;
+   uint8_t slot;
+
+   while (wheel.now != target)
+   {
+      if (wheel.count == 0)
+      {
+         wheel.now = target;
+         break;
+      }
+
+      wheel.now++;
+
+      // each time a level wraps, the next slot of the level above is spread over the levels below
+      for (level = 1; level < TIMER_WHEEL_LEVELS; level++)
+      {
+         if (wheel.now & ((1UL << (TIMER_WHEEL_BITS * level)) - 1))
+            break;
+
+         slot = (wheel.now >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+         timer = wheel.slots[level][slot];
+         wheel.slots[level][slot] = NULL;
+
+         while (timer != NULL)
+         {
+            timer_t* next = timer->next;
+
+            _timer_wheel_link(timer);
+            timer = next;
+         }
+      }
+
+      slot = wheel.now & (TIMER_WHEEL_SLOTS - 1);
+
+      while ((timer = wheel.slots[0][slot]) != NULL)
+      {
+         wheel.slots[0][slot] = timer->next;
+         timer->flags &= ~TIMER_FLAG_QUEUED;
+
+         if (timer->flags & TIMER_FLAG_PERIODIC)
+         {
+            // periods missed within one batch of ticks collapse into a single expiry like in the list walk
+            timer->value.current = target + timer->value.reset - ((target - wheel.now) % timer->value.reset);
+            _timer_wheel_link(timer);
+         }
+         else
+         {
+            timer->value.current = (timer->flags & TIMER_FLAG_COUNTUP) ? timer->value.reset : 0;
+            timer->flags &= ~TIMER_FLAG_ENABLED;
+            wheel.count--;
+         }
+
+         fired |= _timer_expired(timer);
+
+         if (timer->fx != NULL)
+         {
+            timer->flags |= TIMER_FLAG_CALLBACK;
+            timer->fx(timer);
+            timer->flags &= ~TIMER_FLAG_CALLBACK;
+         }
+      }
+   }
+
+   return fired;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifdef TIMER_TICKLESS
+static uint32_t _timer_wheel_next()
+{
+   uint32_t value = UINT32_MAX;
+   uint32_t remaining;
+   uint32_t index;
+   uint8_t level;
+   uint8_t slot;
+
+   if (wheel.count == 0)
+      return value;
+
+   // the first occupied slot of each level bounds the next expiry or cascade from below
+   for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+   {
+      index = wheel.now >> (TIMER_WHEEL_BITS * level);
+
+      for (slot = 1; slot <= TIMER_WHEEL_SLOTS; slot++)
+      {
+         if (wheel.slots[level][(index + slot) & (TIMER_WHEEL_SLOTS - 1)] != NULL)
+         {
+            remaining = ((index + slot) << (TIMER_WHEEL_BITS * level)) - wheel.now;
+
+            if (remaining < value)
+               value = remaining;
+
+            break;
+         }
+      }
+   }
+
+   return value;
+}
+#endif
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_link(timer_t** list, timer_t* timer, uint32_t value)
+{
+   // async timers are kept sorted by expiry, each node holding the delta to its predecessor
+   while ((*list != NULL) && ((*list)->value.current <= value))
+   {
+      value -= (*list)->value.current;
+      list = &(*list)->next;
+   }
+
+   if (*list != NULL)
+      (*list)->value.current -= value;
+
+   timer->value.current = value;
+   timer->next = *list;
+   timer->flags |= TIMER_FLAG_QUEUED;
+   *list = timer;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static uint32_t _timer_unlink(timer_t** list, timer_t* timer)
+{
+   uint32_t value = 0;
+
+   while (*list != NULL)
+   {
+      value += (*list)->value.current;
+
+      if (*list == timer)
+      {
+         *list = timer->next;
+
+         if (*list != NULL)
+            (*list)->value.current += timer->value.current;
+
+         break;
+      }
+
+      list = &(*list)->next;
+   }
+
+   timer->flags &= ~TIMER_FLAG_QUEUED;
+
+   return value;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_attach(timer_t* timer)
+{
+   uint32_t value;
+
+   if ((timer->flags & TIMER_FLAG_ENABLED) == 0)
+      return;
+
+   if (timer->value.reset == 0)
+      return;
+
+#ifndef TIMER_WHEEL
+   if ((timer->flags & TIMER_FLAG_ASYNC) == 0)
+      return;
+#endif
+
+   value = timer->value.current;
+
+   if (timer->flags & TIMER_FLAG_COUNTUP)
+      value = (value < timer->value.reset) ? (timer->value.reset - value) : 0;
+
+#ifdef TIMER_WHEEL
+   if ((timer->flags & TIMER_FLAG_ASYNC) == 0)
+   {
+      // expires on the next tick at the earliest, as in the list walk
+      timer->value.current = wheel.now + ((value > 0) ? value : 1);
+      wheel.count++;
+      _timer_wheel_link(timer);
+      return;
+   }
+#endif
+
+   _timer_link(_timer_list(timer), timer, value + _timer_pending(_timer_list(timer)));
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_cancel(timer_t* timer)
+{
+   uint8_t index;
+
+   // entries are cleared rather than removed, timer_update() skips them when it gets there, each clear is one pointer
+   // store made with interrupts off by the caller
+   for (index = deferred.tail; index != deferred.head; index++)
+   {
+      if (deferred.buffer[index & (TIMER_DEFER_SIZE - 1)] == timer)
+         deferred.buffer[index & (TIMER_DEFER_SIZE - 1)] = NULL;
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_detach(timer_t* timer)
+{
+   uint32_t value;
+   uint32_t pending;
+
+   if ((timer->flags & TIMER_FLAG_QUEUED) == 0)
+      return;
+
+#ifdef TIMER_WHEEL
+   if ((timer->flags & TIMER_FLAG_ASYNC) == 0)
+   {
+      _timer_wheel_unlink(timer);
+      value = timer->value.current - wheel.now;
+   }
+   else
+#endif
+   {
+      value = _timer_unlink(_timer_list(timer), timer);
+      pending = _timer_pending(_timer_list(timer));
+      value = (value > pending) ? (value - pending) : 0;
+   }
+
+   if (timer->flags & TIMER_FLAG_COUNTUP)
+      timer->value.current = timer->value.reset - value;
+   else
+      timer->value.current = value;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_forget(timer_t* timer)
+{
+   // timer_add() also gets timers that were never added, so the lists are searched rather than the flags trusted
+#ifdef TIMER_WHEEL
+   uint8_t level;
+   uint8_t slot;
+
+   for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+   {
+      for (slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+      {
+         if (_timer_remove(&wheel.slots[level][slot], timer))
+            wheel.count--;
+      }
+   }
+#else
+   _timer_remove(&timers[1], timer);
+#endif
+
+   _timer_unlink(&timers[0], timer);
+   _timer_unlink(&timers[2], timer);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_tick(timer_t** list, uint32_t value)
+{
+   timer_events_t fired = 0;
+   timer_t* timer;
+
+   while (((timer = *list) != NULL) && (timer->value.current <= value))
+   {
+      // the queue is now based at this timer's expiry, which is lag behind the current time
+      value -= timer->value.current;
+      lag[list - timers] = value;
+
+      *list = timer->next;
+      timer->flags &= ~TIMER_FLAG_QUEUED;
+
+      if (timer->flags & TIMER_FLAG_PERIODIC)
+      {
+         // relinked relative to its own expiry rather than to now so that it does not drift
+         _timer_link(list, timer, timer->value.reset);
+      }
+      else
+      {
+         if (timer->flags & TIMER_FLAG_COUNTUP)
+            timer->value.current = timer->value.reset;
+
+         timer->flags &= ~TIMER_FLAG_ENABLED;
+      }
+
+      fired |= _timer_expired(timer);
+
+      if (timer->fx == NULL)
+         continue;
+
+      if (timer->flags & TIMER_FLAG_DEFER)
+      {
+         uint8_t count = deferred.head - deferred.tail;
+
+         if (count < TIMER_DEFER_SIZE)
+         {
+            deferred.buffer[deferred.head & (TIMER_DEFER_SIZE - 1)] = timer;
+            deferred.head++;
+
+            if (++count > deferred.peak)
+               deferred.peak = count;
+         }
+         else
+         {
+            deferred.drops++;
+         }
+      }
+      else
+      {
+         timer->flags |= TIMER_FLAG_CALLBACK;
+         timer->fx(timer);
+         timer->flags &= ~TIMER_FLAG_CALLBACK;
+      }
+   }
+
+   if (timer != NULL)
+      timer->value.current -= value;
+
+   lag[list - timers] = 0;
+   events |= fired;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static uint32_t _timer_millis(uint16_t counts)
+{
+   // 32768 counts per 1000 ms, the remainder is carried so the average is exact
+   uint32_t value = (uint32_t) counts * 1000 + fraction;
+
+   fraction = value & 0x7FFF;
+
+   return value >> 15;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifdef TIMER_TICKLESS
+static uint32_t _timer_elapsed()
+{
+   uint16_t counts = RTC.CNT - stamp;
+
+   stamp += counts;
+   epoch += counts;
+
+   return _timer_millis(counts);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_schedule()
+{
+   uint32_t value = UINT32_MAX;
+   uint16_t counts;
+   uint16_t now;
+   timer16_t* list16;
+
+#ifdef TIMER_WHEEL
+   value = _timer_wheel_next();
+#else
+   uint32_t remaining;
+   timer_t* list;
+
+   for (list = timers[1]; list != NULL; list = list->next)
+   {
+      if ((list->flags & TIMER_FLAG_ENABLED) && (list->value.reset > 0))
+      {
+         remaining = list->value.current;
+
+         if (list->flags & TIMER_FLAG_COUNTUP)
+            remaining = (remaining < list->value.reset) ? (list->value.reset - remaining) : 0;
+
+         if (remaining < value)
+            value = remaining;
+      }
+   }
+#endif
+
+   for (list16 = timers16[1]; list16 != NULL; list16 = list16->next)
+   {
+      if ((list16->flags & TIMER_FLAG_ENABLED) && (list16->value.reset > 0) && (list16->value.current < value))
+         value = list16->value.current;
+   }
+
+   // sync timers consume the ticks accumulated since the last timer_update()
+   value = (value > ticks) ? (value - ticks) : 0;
+
+   if ((timers[0] != NULL) && (timers[0]->value.current < value))
+      value = timers[0]->value.current;
+
+   if ((timers16[0] != NULL) && (timers16[0]->value.current < value))
+      value = timers16[0]->value.current;
+
+   if (value > (((uint32_t) TIMER_TICKLESS_MAX * 1000) >> 15))
+      value = ((uint32_t) TIMER_TICKLESS_MAX * 1000) >> 15;
+
+   counts = (value > 0) ? (uint16_t) (((value << 15) - fraction + 999) / 1000) : 0;
+   now = RTC.CNT - stamp;
+
+   if (counts < (uint16_t) (now + TIMER_TICKLESS_LEAD))
+      counts = now + TIMER_TICKLESS_LEAD;
+
+   // most calls leave the deadline where it was, a write would wait on the RTC clock domain for nothing
+   if ((uint16_t) (stamp + counts) == compare)
+      return;
+
+   compare = stamp + counts;
+
+   // timer_update() waits for the previous write with interrupts on, so this only spins after a write from elsewhere
+   while (RTC.STATUS & RTC_CMPBUSY_bm);
+   RTC.CMP = compare;
+}
+#else
+#define _timer_schedule() do { } while (0)
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_usec_schedule()
+{
+   timer_t* timer = timers[2];
+   uint16_t counts = TCB0.CNT;
+   uint16_t value = counts / TIMER_USEC_COUNTS;
+
+   if (timer == NULL)
+   {
+      TCB0.CTRLA = 0;
+      TCB0.CNT = 0;
+      TCB0.INTFLAGS = TCB_CAPT_bm;
+      lag[2] = 0;
+      shot = 0;
+      return;
+   }
+
+   // the pending interrupt accounts for the shot and reschedules
+   if (TCB0.INTFLAGS & TCB_CAPT_bm)
+      return;
+
+   // move the queue base to now and restart the period, keeping the sub-microsecond remainder
+   // the base cannot pass the head, how far the head is overdue stays in the lag for the next interrupt
+   if (timer->value.current > value)
+   {
+      timer->value.current -= value;
+   }
+   else
+   {
+      lag[2] += value - timer->value.current;
+      timer->value.current = 0;
+   }
+
+   shot = (timer->value.current < TIMER_USEC_SHOT) ? timer->value.current : TIMER_USEC_SHOT;
+
+   if (shot < TIMER_USEC_MIN)
+      shot = TIMER_USEC_MIN;
+
+   TCB0.CCMP = shot * TIMER_USEC_COUNTS - 1;
+   TCB0.CNT = counts % TIMER_USEC_COUNTS;
+   TCB0.INTFLAGS = TCB_CAPT_bm;
+   TCB0.CTRLA = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _timer_changed(timer_t* timer)
+{
+   if (timer->flags & TIMER_FLAG_USEC)
+      _timer_usec_schedule();
+   else
+      _timer_schedule();
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+ISR(TCB0_INT_vect)
+{
+   // the counter restarted at the compare match, so it holds the interrupt latency
+   uint16_t counts = TCB0.CNT;
+
+   TCB0.INTFLAGS = TCB_CAPT_bm;
+
+   if (counts > jitter)
+      jitter = counts;
+
+   _timer_tick(&timers[2], lag[2] + shot);
+   _timer_usec_schedule();
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+ISR(RTC_CNT_vect)
+{
+#ifdef TIMER_TICKLESS
+   uint32_t value;
+
+   RTC.INTFLAGS = RTC.INTFLAGS;
+
+   value = _timer_elapsed();
+   ticks += value;
+   _timer16_tick(&timers16[0], value);
+   _timer_tick(&timers[0], value);
+   _timer_schedule();
+#else
+   uint32_t value;
+
+   epoch += TIMER_COUNTS;
+   value = _timer_millis(TIMER_COUNTS);
+
+   if (value > 0)
+   {
+      ticks += value;
+      _timer16_tick(&timers16[0], value);
+      _timer_tick(&timers[0], value);
+   }
+
+   RTC.INTFLAGS = RTC.INTFLAGS;
+#endif
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer_add(timer_t* timer, uint16_t flags, uint32_t value, void (*fx)(timer_t*))
+{
+   if (value > 0)
+   {
+      if (flags & TIMER_FLAG_USEC)
+      {
+         if (value < TIMER_USEC_MIN)
+            value = TIMER_USEC_MIN;
+      }
+      else if (value < TIMER_MSEC)
+      {
+         value = TIMER_MSEC;
+      }
+   }
+   else
+   {
+      flags &= ~TIMER_FLAG_ENABLED;
+   }
+
+   // a timer added again keeps its event bit, the others get the next free one while they last
+   if ((timer->event == 0) || (timer->event > assigned))
+      timer->event = (assigned < TIMER_EVENTS_MAX) ? ++assigned : 0;
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      // a timer added again leaves the list it is on before its flags and next pointer are rewritten
+      _timer_forget(timer);
+      _timer_cancel(timer);
+
+      timer->flags = flags;
+
+// Code generated by MCHP Chatbot
+// TIMER_FLAG_ASYNC determines if the timer is async (ticks from ISR) or sync (manual update)
+// In your example, since TIMER_FLAG_ASYNC is not set, the timer is sync and scheduled for 1 ms intervals
+      if (flags & TIMER_FLAG_COUNTUP)
+         timer->value.current = 0;
+      else
+         timer->value.current = value;
+
+      timer->value.reset = value;
+      timer->fx = fx;
+
+#ifndef TIMER_WHEEL
+      if ((flags & TIMER_FLAG_ASYNC) == 0)
+      {
+         timer->next = timers[1];
+         timers[1] = timer;
+      }
+      else
+#endif
+      {
+         timer->next = NULL;
+         _timer_attach(timer);
+      }
+
+      _timer_changed(timer);
+   }
+
+   return timer->event > 0;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer_expired(timer_t* timer, bool clear)
+{
+   bool value;
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      value = (timer->flags & TIMER_FLAG_EXPIRED) ? true : false;
+
+      if (clear)
+         timer->flags &= ~TIMER_FLAG_EXPIRED;
+   }
+
+   return value;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer_overflowed(timer_t* timer, bool clear)
+{
+   bool value;
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      value = (timer->flags & TIMER_FLAG_OVERFLOW) ? true : false;
+
+      if (clear)
+         timer->flags &= ~TIMER_FLAG_OVERFLOW;
+   }
+
+   return value;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer_enable(timer_t* timer, bool enable)
+{
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      _timer_detach(timer);
+
+      if (timer->value.reset == 0)
+         timer->flags &= ~TIMER_FLAG_PERIODIC;
+
+      if (enable)
+      {
+         if (timer->value.current > 0)
+            timer->flags |= TIMER_FLAG_ENABLED;
+         else
+         {
+            timer->flags |= TIMER_FLAG_EXPIRED;
+            events |= timer_event(timer);
+         }
+      }
+      else
+      {
+         timer->flags &= ~TIMER_FLAG_ENABLED;
+         _timer_cancel(timer);
+      }
+
+      _timer_attach(timer);
+      _timer_changed(timer);
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer_expire(timer_t* timer)
+{
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      _timer_detach(timer);
+      timer->flags |= TIMER_FLAG_EXPIRED;
+      events |= timer_event(timer);
+
+      if (timer->flags & TIMER_FLAG_PERIODIC)
+      {
+         if (timer->flags & TIMER_FLAG_COUNTUP)
+            timer->value.current = 0;
+         else
+            timer->value.current = timer->value.reset;
+      }
+      else
+      {
+         if (timer->flags & TIMER_FLAG_COUNTUP)
+            timer->value.current = timer->value.reset;
+         else
+            timer->value.current = 0;
+
+         timer->flags &= ~TIMER_FLAG_ENABLED;
+      }
+
+      _timer_attach(timer);
+      _timer_changed(timer);
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer_reset(timer_t* timer)
+{
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      _timer_detach(timer);
+      timer->flags &= ~(TIMER_FLAG_OVERFLOW | TIMER_FLAG_EXPIRED);
+
+      if (timer->flags & TIMER_FLAG_COUNTUP)
+         timer->value.current = 0;
+      else
+         timer->value.current = timer->value.reset;
+
+      _timer_attach(timer);
+      _timer_changed(timer);
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint32_t timer_get(timer_t* timer, uint32_t* reset)
+{
+   uint32_t value;
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+#ifdef TIMER_WHEEL
+      if ((timer->flags & (TIMER_FLAG_QUEUED | TIMER_FLAG_ASYNC)) == TIMER_FLAG_QUEUED)
+      {
+         value = timer->value.current - wheel.now;
+
+         if (timer->flags & TIMER_FLAG_COUNTUP)
+            value = timer->value.reset - value;
+      }
+      else
+#endif
+      if (timer->flags & TIMER_FLAG_QUEUED)
+      {
+         timer_t* list = *_timer_list(timer);
+         uint32_t pending = _timer_pending(_timer_list(timer));
+
+         for (value = 0; list != NULL; list = list->next)
+         {
+            value += list->value.current;
+
+            if (list == timer)
+               break;
+         }
+
+         value = (value > pending) ? (value - pending) : 0;
+
+         if (timer->flags & TIMER_FLAG_COUNTUP)
+            value = timer->value.reset - value;
+      }
+      else
+      {
+         value = timer->value.current;
+      }
+
+      if (reset != NULL)
+         *reset = timer->value.reset;
+   }
+
+   return value;
+}
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-static timer_t* timers[2];
-static volatile uint32_t ticks;
+void timer_set(timer_t* timer, uint32_t current, uint32_t reset)
+{
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      _timer_detach(timer);
+      timer->flags &= ~(TIMER_FLAG_OVERFLOW | TIMER_FLAG_EXPIRED);
+      timer->value.current = current;
+      timer->value.reset = reset;
+
+      if (reset == 0)
+         timer->flags &= ~TIMER_FLAG_PERIODIC;
+
+      _timer_attach(timer);
+      _timer_changed(timer);
+   }
+}
 
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-static void _timer_update(timer_t* list, uint32_t value)
+void timer_remove(timer_t* timer)
 {
-   while (list != NULL)
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
-      if ((list->flags & TIMER_FLAG_ENABLED) && (list->value.reset > 0))
-      {
-         if (list->flags & TIMER_FLAG_COUNTUP)
-         {
-            list->value.current += value;
+      _timer_detach(timer);
+      _timer_cancel(timer);
+      timer->flags &= ~TIMER_FLAG_ENABLED;
 
-            if (list->value.current >= list->value.reset)
-            {
-               if (list->flags & TIMER_FLAG_PERIODIC)
-                  list->value.current = 0;
-               else
-                  list->flags &= ~TIMER_FLAG_ENABLED;
+#ifndef TIMER_WHEEL
+      if ((timer->flags & TIMER_FLAG_ASYNC) == 0)
+         _timer_remove(&timers[1], timer);
+#endif
 
-               if (list->flags & TIMER_FLAG_EXPIRED)
-                  list->flags |= TIMER_FLAG_OVERFLOW;
-               else
-                  list->flags |= TIMER_FLAG_EXPIRED;
+      timer->next = NULL;
+      _timer_changed(timer);
+   }
+}
 
-               if (list->fx != NULL)
-               {
-                  list->flags |= TIMER_FLAG_CALLBACK;
-                  list->fx(list);
-                  list->flags &= ~TIMER_FLAG_CALLBACK;
-               }
-            }
-         }
-         else
-         {
-            if (list->value.current <= value)
-            {
-               if (list->flags & TIMER_FLAG_PERIODIC)
-                  list->value.current = list->value.reset;
-               else
-                  list->flags &= ~TIMER_FLAG_ENABLED;
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t timer_deferred_peak(bool reset)
+{
+   size_t peak;
 
-               if (list->flags & TIMER_FLAG_EXPIRED)
-                  list->flags |= TIMER_FLAG_OVERFLOW;
-               else
-                  list->flags |= TIMER_FLAG_EXPIRED;
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      peak = deferred.peak;
 
-               if (list->fx != NULL)
-               {
-                  list->flags |= TIMER_FLAG_CALLBACK;
-                  list->fx(list);
-                  list->flags &= ~TIMER_FLAG_CALLBACK;
-               }
-            }
-            else
-            {
-               list->value.current -= value;
-            }
-         }
-      }
+      if (reset)
+         deferred.peak = 0;
+   }
 
-      list = list->next;
+   return peak;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t timer_deferred_drops(bool reset)
+{
+   size_t drops;
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      drops = deferred.drops;
+
+      if (reset)
+         deferred.drops = 0;
    }
+
+   return drops;
 }
 
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-ISR(RTC_CNT_vect)
+const void* timer_deferred_running()
 {
-   ticks += TIMER_MSEC;
-   _timer_update(timers[0], TIMER_MSEC);
-   RTC.INTFLAGS = RTC.INTFLAGS;
+   return deferred.running;
 }
 
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void timer_add(timer_t* timer, uint16_t flags, uint32_t value, void (*fx)(timer_t*))
+bool timer_usec_add(timer_t* timer, uint16_t flags, uint32_t value, void (*fx)(timer_t*))
 {
-   if (value > 0)
+   return timer_add(timer, flags | TIMER_FLAG_USEC | TIMER_FLAG_ASYNC, value, fx);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer_usec_active()
+{
+   bool active;
+
+   // TCB0 stops in standby, so callers use this to choose the sleep mode
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
-      if (value < TIMER_MSEC)
-         value = TIMER_MSEC;
+      active = (timers[2] != NULL);
    }
-   else
+
+   return active;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint16_t timer_usec_jitter(bool reset)
+{
+   uint16_t value;
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
-      flags &= ~TIMER_FLAG_ENABLED;
+      value = jitter;
+
+      if (reset)
+         jitter = 0;
    }
 
-   timer->flags = flags;
+   return (value + TIMER_USEC_COUNTS - 1) / TIMER_USEC_COUNTS;
+}
 
-// Code generated by MCHP Chatbot
-// TIMER_FLAG_ASYNC determines if the timer is async (ticks from ISR) or sync (manual update)
-// In your example, since TIMER_FLAG_ASYNC is not set, the timer is sync and scheduled for 1 ms intervals
-   if (flags & TIMER_FLAG_COUNTUP)
-      timer->value.current = 0;
-   else
-      timer->value.current = value;
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer16_add(timer16_t* timer, uint8_t flags, uint16_t value, void (*fx)(timer16_t*))
+{
+   if (value == 0)
+      flags &= ~TIMER_FLAG_ENABLED;
+   else if (value < TIMER_MSEC)
+      value = TIMER_MSEC;
 
-   timer->value.reset = value;
-   timer->fx = fx;
+   if ((timer->event == 0) || (timer->event > assigned))
+      timer->event = (assigned < TIMER_EVENTS_MAX) ? ++assigned : 0;
 
    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
+      // as in timer_add(), the lists are searched because the timer may never have been added
+      _timer16_unlink(&timers16[0], timer);
+      _timer16_remove(&timers16[1], timer);
+
+      timer->flags = flags & ~(TIMER_FLAG_QUEUED | TIMER_FLAG_CALLBACK);
+      timer->value.current = value;
+      timer->value.reset = value;
+      timer->fx = fx;
+
       if (flags & TIMER_FLAG_ASYNC)
       {
-         timer->next = timers[0];
-         timers[0] = timer;
+         timer->next = NULL;
+         _timer16_attach(timer);
       }
       else
       {
-         timer->next = timers[1];
-         timers[1] = timer;
+         timer->next = timers16[1];
+         timers16[1] = timer;
       }
+
+      _timer_schedule();
    }
+
+   return timer->event > 0;
 }
 
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-bool timer_expired(timer_t* timer, bool clear)
+bool timer16_expired(timer16_t* timer, bool clear)
 {
    bool value;
 
@@ -160,7 +1487,7 @@ bool timer_expired(timer_t* timer, bool clear)
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-bool timer_overflowed(timer_t* timer, bool clear)
+bool timer16_overflowed(timer16_t* timer, bool clear)
 {
    bool value;
 
@@ -178,81 +1505,117 @@ bool timer_overflowed(timer_t* timer, bool clear)
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void timer_enable(timer_t* timer, bool enable)
+void timer16_enable(timer16_t* timer, bool enable)
 {
    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
+      _timer16_detach(timer);
+
       if (timer->value.reset == 0)
          timer->flags &= ~TIMER_FLAG_PERIODIC;
 
       if (enable)
       {
-         if (timer->value.current > 0)
-            timer->flags |= TIMER_FLAG_ENABLED;
-         else
-            timer->flags |= TIMER_FLAG_EXPIRED;
+         if ((timer->flags & TIMER_FLAG_ENABLED) == 0)
+         {
+            if (timer->value.current > 0)
+            {
+               timer->flags |= TIMER_FLAG_ENABLED;
+            }
+            else
+            {
+               timer->flags |= TIMER_FLAG_EXPIRED;
+               events |= timer_event(timer);
+            }
+         }
       }
-      else
+      else if (timer->flags & TIMER_FLAG_ENABLED)
       {
+         // a stopped counter keeps the time that was left
+         if (timer->value.current == 0)
+            timer->value.current = 1;
+
          timer->flags &= ~TIMER_FLAG_ENABLED;
       }
+
+      _timer16_attach(timer);
+      _timer_schedule();
    }
 }
 
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void timer_expire(timer_t* timer)
+void timer16_expire(timer16_t* timer)
 {
    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
+      _timer16_detach(timer);
       timer->flags |= TIMER_FLAG_EXPIRED;
+      events |= timer_event(timer);
 
       if (timer->flags & TIMER_FLAG_PERIODIC)
       {
-         if (timer->flags & TIMER_FLAG_COUNTUP)
-            timer->value.current = 0;
-         else
-            timer->value.current = timer->value.reset;
+         timer->value.current = timer->value.reset;
       }
       else
       {
-         if (timer->flags & TIMER_FLAG_COUNTUP)
-            timer->value.current = timer->value.reset;
-         else
-            timer->value.current = 0;
-
+         timer->value.current = 0;
          timer->flags &= ~TIMER_FLAG_ENABLED;
       }
+
+      _timer16_attach(timer);
+      _timer_schedule();
    }
 }
 
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void timer_reset(timer_t* timer)
+void timer16_reset(timer16_t* timer)
 {
    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
+      _timer16_detach(timer);
       timer->flags &= ~(TIMER_FLAG_OVERFLOW | TIMER_FLAG_EXPIRED);
-
-      if (timer->flags & TIMER_FLAG_COUNTUP)
-         timer->value.current = 0;
-      else
-         timer->value.current = timer->value.reset;
+      timer->value.current = timer->value.reset;
+      _timer16_attach(timer);
+      _timer_schedule();
    }
 }
 
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-uint32_t timer_get(timer_t* timer, uint32_t* reset)
+uint16_t timer16_get(timer16_t* timer, uint16_t* reset)
 {
-   uint32_t value;
+   uint16_t value;
 
    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
-      value = timer->value.current;
+      if (timer->flags & TIMER_FLAG_QUEUED)
+      {
+         timer16_t* list = timers16[0];
+         uint32_t sum = 0;
+         uint16_t pending = _timer16_pending();
+
+         for (; list != NULL; list = list->next)
+         {
+            sum += list->value.current;
+
+            if (list == timer)
+               break;
+         }
+
+         value = (sum > pending) ? (sum - pending) : 0;
+      }
+      else
+      {
+         value = timer->value.current;
+      }
+
+      if (timer->flags & TIMER_FLAG_COUNTUP)
+         value = (value < timer->value.reset) ? (timer->value.reset - value) : 0;
 
       if (reset != NULL)
          *reset = timer->value.reset;
@@ -264,48 +1627,180 @@ uint32_t timer_get(timer_t* timer, uint32_t* reset)
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void timer_set(timer_t* timer, uint32_t current, uint32_t reset)
+void timer16_set(timer16_t* timer, uint16_t current, uint16_t reset)
 {
    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
+      _timer16_detach(timer);
       timer->flags &= ~(TIMER_FLAG_OVERFLOW | TIMER_FLAG_EXPIRED);
-      timer->value.current = current;
       timer->value.reset = reset;
 
       if (reset == 0)
          timer->flags &= ~TIMER_FLAG_PERIODIC;
+
+      if (timer->flags & TIMER_FLAG_COUNTUP)
+         current = (current < reset) ? (reset - current) : 0;
+
+      timer->value.current = current;
+      _timer16_attach(timer);
+      _timer_schedule();
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer16_remove(timer16_t* timer)
+{
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      _timer16_detach(timer);
+      _timer16_remove(&timers16[1], timer);
+
+      timer->flags &= ~TIMER_FLAG_ENABLED;
+      timer->next = NULL;
+      _timer_schedule();
    }
 }
 
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void timer_update()
+timer_events_t timer_update()
 {
+   timer_events_t value;
+   timer_events_t fired = 0;
    uint32_t ticks0;
 
    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
+#ifdef TIMER_TICKLESS
+      ticks0 = _timer_elapsed();
+      ticks += ticks0;
+      _timer16_tick(&timers16[0], ticks0);
+      _timer_tick(&timers[0], ticks0);
+#endif
       ticks0 = ticks;
       ticks = 0;
    }
 
+   // callbacks of TIMER_FLAG_DEFER timers are queued by the ISR and run here in expiry order
+   while (deferred.tail != deferred.head)
+   {
+      timer_t* volatile* slot = &deferred.buffer[deferred.tail & (TIMER_DEFER_SIZE - 1)];
+      timer_t* timer;
+
+      // an asynchronous callback may clear the slot while it is read, a torn pointer never reads the same twice
+      do
+      {
+         timer = *slot;
+      }
+      while (timer != *slot);
+
+      deferred.tail++;
+
+      if (timer == NULL)
+         continue;
+
+      // the flags are left alone, the interrupt may expire the same timer again while its callback runs
+      deferred.running = timer;
+      timer->fx(timer);
+      deferred.running = NULL;
+   }
+
+   // the sync walks run with interrupts on, so their bits stay local until the interrupts are off again
+#ifdef TIMER_WHEEL
+   if (ticks0 > 0)
+      fired = _timer_wheel_update(ticks0);
+#else
+   if (ticks0 > 0)
+      fired = _timer_update(timers[1], ticks0);
+#endif
+
    if (ticks0 > 0)
-      _timer_update(timers[1], ticks0);
+      fired |= _timer16_update(timers16[1], (ticks0 < 0xFFFF) ? ticks0 : 0xFFFF);
+
+#ifdef TIMER_TICKLESS
+   // the RTC takes a few of its own cycles to accept a compare value, that wait belongs outside the atomic block
+   while (RTC.STATUS & RTC_CMPBUSY_bm);
+#endif
+
+   // async timers that fired since the last update are included
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      value = events | fired;
+      events = 0;
+#ifdef TIMER_TICKLESS
+      _timer_schedule();
+#endif
+   }
+
+   return value;
 }
 
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void timer_init()
+static uint64_t _timer_now()
 {
-#if TIMER_MSEC == 1
-   RTC.CMP = 32;
-   RTC.PER = 32;
-#elif TIMER_MSEC == 2
-   RTC.CMP = 64;
-   RTC.PER = 64;
+   uint64_t value;
+   uint16_t count;
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      value = epoch;
+#ifdef TIMER_TICKLESS
+      count = RTC.CNT - stamp;
+#else
+      count = RTC.CNT;
+
+      // the counter wrapped but RTC_CNT_vect has not run yet
+      if (RTC.INTFLAGS & RTC_OVF_bm)
+      {
+         count = RTC.CNT;
+         value += TIMER_COUNTS;
+      }
 #endif
+   }
+
+   return value + count;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint64_t timer_now_us()
+{
+   // 1000000 / 32768 = 15625 / 512
+   return (_timer_now() * 15625) >> 9;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint64_t timer_now_ms()
+{
+   // 1000 / 32768 = 125 / 4096
+   return (_timer_now() * 125) >> 12;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer_init()
+{
+#ifdef TIMER_TICKLESS
+   stamp = 0;
+   compare = TIMER_TICKLESS_MAX;
+   RTC.PER = 0xFFFF;
+   RTC.CMP = compare;
    RTC.INTCTRL = RTC_CMP_bm;
-   RTC.CTRLA = RTC_RTCEN_bm;
+#else
+   RTC.PER = TIMER_COUNTS - 1;
+   RTC.INTCTRL = RTC_OVF_bm;
+#endif
+   RTC.CTRLA = RTC_RTCEN_bm | RTC_RUNSTDBY_bm;
+
+   TCB0.CTRLB = TCB_CNTMODE_INT_gc;
+   TCB0.INTCTRL = TCB_CAPT_bm;
 }
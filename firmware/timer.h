@@ -5,6 +5,7 @@
 #define TIMER_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /*******************************************************************************************************************
@@ -17,6 +18,19 @@
 #define TIMER_FLAG_EXPIRED  0x0010
 #define TIMER_FLAG_OVERFLOW 0x0020
 #define TIMER_FLAG_CALLBACK 0x0040
+#define TIMER_FLAG_QUEUED   0x0080
+// callbacks of deferred timers run from timer_update(), one still waiting there is dropped by
+// timer_enable(false), timer_remove() and timer_add(), only a timer stopped from an interrupt just as its callback is
+// taken off the queue may still see that one callback, which then finds itself disabled
+#define TIMER_FLAG_DEFER    0x0100
+#define TIMER_FLAG_USEC     0x0200
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+// timer_update() reports the first TIMER_EVENTS_MAX timers added, the add functions return false for any later timer,
+// which still runs but has to be polled with timer_expired()
+#define TIMER_EVENTS_MAX (sizeof(timer_events_t) * 8)
 
 /*******************************************************************************************************************
  *
@@ -41,7 +55,29 @@
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-#define timer_callback(t) (((t)->flags & TIMER_FLAG_CALLBACK) ? true : false)
+// deferred callbacks are tracked apart from the flags, which the interrupt may change while the callback runs
+#define timer_callback(t) ((((t)->flags & TIMER_FLAG_CALLBACK) || ((const void*) (t) == timer_deferred_running())) ? \
+   true : false)
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define timer_deferred(t) (((t)->flags & TIMER_FLAG_DEFER) ? true : false)
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define timer_usec(t) (((t)->flags & TIMER_FLAG_USEC) ? true : false)
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#define timer_event(t) (((t)->event > 0) ? ((timer_events_t) 1 << ((t)->event - 1)) : 0)
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+typedef uint32_t timer_events_t;
 
 /*******************************************************************************************************************
  *
@@ -50,6 +86,7 @@ typedef struct timer
 {
    struct timer* next;
    volatile uint16_t flags;
+   uint8_t event;
 
    struct
    {
@@ -65,7 +102,27 @@ typedef struct timer
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void timer_add(timer_t* timer, uint16_t flags, uint32_t value, void (*fx)(timer_t*));
+typedef struct timer16
+{
+   struct timer16* next;
+   volatile uint8_t flags;
+   uint8_t event;
+
+   struct
+   {
+      volatile uint16_t current;
+      uint16_t reset;
+
+   } value;
+
+   void (*fx)(struct timer16*);
+
+} timer16_t;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer_add(timer_t* timer, uint16_t flags, uint32_t value, void (*fx)(timer_t*));
 
 /*******************************************************************************************************************
  *
@@ -105,7 +162,97 @@ void timer_set(timer_t* timer, uint32_t current, uint32_t reset);
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void timer_update();
+void timer_remove(timer_t* timer);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer_usec_add(timer_t* timer, uint16_t flags, uint32_t value, void (*fx)(timer_t*));
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer_usec_active();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint16_t timer_usec_jitter(bool reset);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t timer_deferred_peak(bool reset);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t timer_deferred_drops(bool reset);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+const void* timer_deferred_running();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint64_t timer_now_us();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint64_t timer_now_ms();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer16_add(timer16_t* timer, uint8_t flags, uint16_t value, void (*fx)(timer16_t*));
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer16_expired(timer16_t* timer, bool clear);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool timer16_overflowed(timer16_t* timer, bool clear);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer16_enable(timer16_t* timer, bool enable);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer16_expire(timer16_t* timer);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer16_reset(timer16_t* timer);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+uint16_t timer16_get(timer16_t* timer, uint16_t* reset);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer16_set(timer16_t* timer, uint16_t current, uint16_t reset);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void timer16_remove(timer16_t* timer);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+timer_events_t timer_update();
 
 /*******************************************************************************************************************
  *
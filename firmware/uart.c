@@ -4,10 +4,31 @@
 #include <avr/interrupt.h>
 #include <avr/io.h>
 #include <stdio.h>
+#include <string.h>
 #include <util/atomic.h>
 #include "main.h"
+#include "timer.h"
 #include "uart.h"
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#ifndef UART_TX_POLICY
+#define UART_TX_POLICY UART_TX_BLOCK
+#endif
+
+#ifndef UART_BAUD_TOLERANCE
+#define UART_BAUD_TOLERANCE 200
+#endif
+
+#if (UART_TX_BUFFER_SIZE > 128) || (UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1))
+#error "UART_TX_BUFFER_SIZE must be a power of two up to 128"
+#endif
+
+#if (UART_RX_BUFFER_SIZE > 128) || (UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1))
+#error "UART_RX_BUFFER_SIZE must be a power of two up to 128"
+#endif
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
@@ -15,8 +36,8 @@
 static volatile struct
 {
    uint8_t buffer[UART_TX_BUFFER_SIZE];
-   size_t ptr;
-   size_t count;
+   uint8_t head;
+   uint8_t tail;
 
 } tx0;
 #endif
@@ -24,16 +45,44 @@ static volatile struct
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
+static uart_tx_policy_t tx_policy = UART_TX_POLICY;
+static int16_t baud_error;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#if UART_RX_BUFFER_SIZE > 0
 static volatile struct
 {
-#if UART_RX_BUFFER_SIZE > 0
    uint8_t buffer[UART_RX_BUFFER_SIZE];
-   size_t ptr;
-   size_t count;
-#endif
-   size_t errors;
+   uint8_t head;
+   uint8_t tail;
 
 } rx0;
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static volatile uart_stats_t stats;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool _uart_rx_check(uint8_t status)
+{
+   // BUFOVF means bytes were lost before this one, the byte itself is intact
+   if (status & USART_BUFOVF_bm)
+      stats.bufovf++;
+
+   if (status & USART_FERR_bm)
+      stats.ferr++;
+
+   if (status & USART_PERR_bm)
+      stats.perr++;
+
+   return (status & (USART_FERR_bm | USART_PERR_bm)) ? false : true;
+}
 
 /*******************************************************************************************************************
  *
@@ -49,13 +98,17 @@ ISR(USART0_TXC_vect)
 #if UART_TX_BUFFER_SIZE > 0
 ISR(USART0_DRE_vect)
 {
-   if (tx0.count > 0)
+   // the ISR only moves the tail, uart_tx() only moves the head
+   uint8_t tail = tx0.tail;
+
+   if (tail != tx0.head)
    {
-      USART0.TXDATAL = tx0.buffer[tx0.ptr++ % UART_TX_BUFFER_SIZE];
-      tx0.count--;
+      USART0.STATUS = USART_TXCIF_bm;
+      USART0.TXDATAL = tx0.buffer[tail & (UART_TX_BUFFER_SIZE - 1)];
+      tx0.tail = ++tail;
    }
 
-   if (tx0.count == 0)
+   if (tail == tx0.head)
       USART0.CTRLA &= ~USART_DREIE_bm;
 }
 #endif
@@ -66,19 +119,78 @@ ISR(USART0_DRE_vect)
 #if UART_RX_BUFFER_SIZE > 0
 ISR(USART0_RXC_vect)
 {
-   USART0.STATUS = USART_ISFIF_bm;
+   USART0.STATUS = USART_RXSIF_bm | USART_ISFIF_bm;
 
-   if (USART0.RXDATAH & (USART_BUFOVF_bm | USART_FERR_bm | USART_PERR_bm))
+   // a start of frame wakes the CPU from standby, the byte itself completes on the next interrupt
+   if ((USART0.STATUS & USART_RXCIF_bm) == 0)
+      return;
+
+   if (_uart_rx_check(USART0.RXDATAH))
    {
-      USART0.RXDATAL;
-      rx0.errors++;
+      // the ISR only moves the head, so when the buffer is full the newest byte is dropped
+      uint8_t head = rx0.head;
+      uint8_t count = head - rx0.tail;
+      uint8_t c = USART0.RXDATAL;
+
+      if (count < UART_RX_BUFFER_SIZE)
+      {
+         rx0.buffer[head & (UART_RX_BUFFER_SIZE - 1)] = c;
+         rx0.head = head + 1;
+
+         if (count >= stats.rx_peak)
+            stats.rx_peak = count + 1;
+      }
+      else
+      {
+         stats.overrun++;
+      }
    }
    else
    {
-      if (rx0.count < UART_RX_BUFFER_SIZE)
-         rx0.buffer[(rx0.ptr + rx0.count++) % UART_RX_BUFFER_SIZE] = USART0.RXDATAL;
-      else
-         rx0.buffer[rx0.ptr++ % UART_RX_BUFFER_SIZE] = USART0.RXDATAL;
+      USART0.RXDATAL;
+   }
+}
+#endif
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+#if UART_TX_BUFFER_SIZE > 0
+static void _uart_tx_drop(size_t count)
+{
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      stats.tx_dropped += count;
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _uart_tx_peak(uint8_t head)
+{
+   uint8_t count = head - tx0.tail;
+
+   if (count > stats.tx_peak)
+      stats.tx_peak = count;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void _uart_tx_reserve(uint8_t length)
+{
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      // the only place the producer moves the tail, so the ISR is held off
+      uint8_t count = tx0.head - tx0.tail;
+
+      if (count > (UART_TX_BUFFER_SIZE - length))
+      {
+         count -= UART_TX_BUFFER_SIZE - length;
+         tx0.tail += count;
+         stats.tx_dropped += count;
+      }
    }
 }
 #endif
@@ -94,7 +206,7 @@ void uart_tx_enable(bool enable)
       {
          USART0.CTRLB |= USART_TXEN_bm;
 #if UART_TX_BUFFER_SIZE > 0
-         if (tx0.count > 0)
+         if (tx0.head != tx0.tail)
             USART0.CTRLA |= USART_DREIE_bm;
 #endif
       }
@@ -119,23 +231,34 @@ void uart_tx(int c)
 #if UART_TX_BUFFER_SIZE > 0
    if (CPU_SREG & CPU_I_bm)
    {
-      bool success = false;
+      uint8_t head = tx0.head;
 
-      do
+      while ((uint8_t) (head - tx0.tail) >= UART_TX_BUFFER_SIZE)
       {
-         ATOMIC_BLOCK(ATOMIC_FORCEON)
+         if ((USART0.CTRLB & USART_TXEN_bm) == 0)
+            return;
+
+         if (tx_policy == UART_TX_DROP_OLDEST)
          {
-            if (tx0.count < UART_TX_BUFFER_SIZE)
-            {
-               tx0.buffer[(tx0.ptr + tx0.count++) % UART_TX_BUFFER_SIZE] = c8;
-               success = true;
-            }
+            _uart_tx_reserve(1);
+            break;
+         }
 
-            if (USART0.CTRLB & USART_TXEN_bm)
-               USART0.CTRLA |= USART_DREIE_bm;
+         // a single byte cannot be written short, so UART_TX_SHORT drops it as well
+         if (tx_policy != UART_TX_BLOCK)
+         {
+            _uart_tx_drop(1);
+            return;
          }
+      }
 
-      } while (!success && (USART0.CTRLB & USART_TXEN_bm));
+      tx0.buffer[head & (UART_TX_BUFFER_SIZE - 1)] = c8;
+      tx0.head = head + 1;
+      _uart_tx_peak(head + 1);
+
+      // the ISR may clear DREIE concurrently, which at worst costs one spurious interrupt
+      if (USART0.CTRLB & USART_TXEN_bm)
+         USART0.CTRLA |= USART_DREIE_bm;
    }
    else
 #endif
@@ -145,11 +268,11 @@ void uart_tx(int c)
          while ((USART0.STATUS & USART_DREIF_bm) == 0);
 
 #if UART_TX_BUFFER_SIZE > 0
-         while (tx0.count > 0)
+         while (tx0.tail != tx0.head)
          {
-            USART0.TXDATAL = tx0.buffer[tx0.ptr++ % UART_TX_BUFFER_SIZE];
+            USART0.TXDATAL = tx0.buffer[tx0.tail & (UART_TX_BUFFER_SIZE - 1)];
             while ((USART0.STATUS & USART_DREIF_bm) == 0);
-            tx0.count--;
+            tx0.tail++;
          }
 #endif
 
@@ -157,7 +280,6 @@ void uart_tx(int c)
          USART0.TXDATAL = c8;
 
          while ((USART0.STATUS & USART_TXCIF_bm) == 0);
-         USART0.STATUS = USART_TXCIF_bm;
       }
    }
 }
@@ -171,18 +293,28 @@ size_t uart_tx_length()
 
    if (USART0.CTRLB & USART_TXEN_bm)
    {
-      ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-      {
-         length = (USART0.STATUS & USART_TXCIF_bm) ? 0 : 1;
+      // the buffer is read first, the ISR clears TXCIF before it moves a byte out of it
 #if UART_TX_BUFFER_SIZE > 0
-         length += tx0.count;
+      length = (uint8_t) (tx0.head - tx0.tail);
 #endif
-      }
+      length += (USART0.STATUS & USART_TXCIF_bm) ? 0 : 1;
    }
 
    return length;
 }
 
+/********************************************************************************************************************
+ *
+ ********************************************************************************************************************/
+size_t uart_tx_space()
+{
+#if UART_TX_BUFFER_SIZE > 0
+   return UART_TX_BUFFER_SIZE - (uint8_t) (tx0.head - tx0.tail);
+#else
+   return 0;
+#endif
+}
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
@@ -195,12 +327,122 @@ void uart_tx_flush()
    else
    {
 #if UART_TX_BUFFER_SIZE > 0
-      ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+      tx0.tail = tx0.head;
+#endif
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t uart_write_policy(const void* data, size_t length, uart_tx_policy_t policy)
+{
+   const uint8_t* p = data;
+   size_t count = 0;
+
+#if UART_TX_BUFFER_SIZE > 0
+   if (CPU_SREG & CPU_I_bm)
+   {
+      // only the newest bytes can end up in the buffer
+      if ((policy == UART_TX_DROP_OLDEST) && (length > UART_TX_BUFFER_SIZE))
       {
-         tx0.count = 0;
+         count = length - UART_TX_BUFFER_SIZE;
+         _uart_tx_drop(count);
+      }
+
+      while (count < length)
+      {
+         uint8_t head;
+         uint8_t index;
+         size_t space;
+         size_t span;
+
+         if (policy == UART_TX_DROP_OLDEST)
+            _uart_tx_reserve(length - count);
+
+         head = tx0.head;
+         index = head & (UART_TX_BUFFER_SIZE - 1);
+         space = UART_TX_BUFFER_SIZE - (uint8_t) (head - tx0.tail);
+
+         if (space == 0)
+         {
+            if ((USART0.CTRLB & USART_TXEN_bm) == 0)
+               break;
+
+            if (policy == UART_TX_BLOCK)
+               continue;
+
+            if (policy == UART_TX_DROP_NEWEST)
+            {
+               _uart_tx_drop(length - count);
+               count = length;
+            }
+
+            break;
+         }
+
+         if (space > (length - count))
+            space = length - count;
+
+         // at most two spans, up to the end of the buffer and from its start
+         span = UART_TX_BUFFER_SIZE - index;
+
+         if (span > space)
+            span = space;
+
+         memcpy((uint8_t*) &tx0.buffer[index], &p[count], span);
+         memcpy((uint8_t*) &tx0.buffer[0], &p[count + span], space - span);
+
+         count += space;
+         tx0.head = head + space;
+         _uart_tx_peak(head + space);
+
+         if (USART0.CTRLB & USART_TXEN_bm)
+            USART0.CTRLA |= USART_DREIE_bm;
       }
+   }
+   else
 #endif
+   {
+      while (count < length)
+         uart_tx(p[count++]);
    }
+
+   return count;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t uart_write(const void* data, size_t length)
+{
+   return uart_write_policy(data, length, tx_policy);
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void uart_tx_policy(uart_tx_policy_t policy)
+{
+   tx_policy = policy;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t uart_tx_dropped(bool reset)
+{
+   size_t dropped;
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      dropped = stats.tx_dropped;
+
+      if (reset)
+         stats.tx_dropped = 0;
+   }
+
+   return dropped;
 }
 
 /*******************************************************************************************************************
@@ -224,38 +466,37 @@ int uart_rx(bool blocking)
 #if UART_RX_BUFFER_SIZE > 0
    if (CPU_SREG & CPU_I_bm)
    {
-      do
-      {
-         ATOMIC_BLOCK(ATOMIC_FORCEON)
-         {
-            if (rx0.count > 0)
-            {
-               c = rx0.buffer[rx0.ptr++ % UART_RX_BUFFER_SIZE];
-               rx0.count--;
-            }
-         }
+      uint8_t tail = rx0.tail;
+
+      while (blocking && (tail == rx0.head));
 
-      } while (blocking && (c == EOF));
+      if (tail != rx0.head)
+      {
+         c = rx0.buffer[tail & (UART_RX_BUFFER_SIZE - 1)];
+         rx0.tail = tail + 1;
+      }
    }
    else
 #endif
    {
 #if UART_RX_BUFFER_SIZE > 0
-      if (rx0.count > 0)
+      if (rx0.tail != rx0.head)
       {
-         c = rx0.buffer[rx0.ptr++ % UART_RX_BUFFER_SIZE];
-         rx0.count--;
+         c = rx0.buffer[rx0.tail & (UART_RX_BUFFER_SIZE - 1)];
+         rx0.tail++;
       }
       else
 #endif
       {
          do
          {
-            if (USART0.RXDATAH & (USART_BUFOVF_bm | USART_FERR_bm | USART_PERR_bm))
-               rx0.errors++;
-
             if (USART0.STATUS & USART_RXCIF_bm)
-               c = USART0.RXDATAL;
+            {
+               if (_uart_rx_check(USART0.RXDATAH))
+                  c = USART0.RXDATAL;
+               else
+                  USART0.RXDATAL;
+            }
 
          } while (blocking && (c == EOF));
       }
@@ -264,6 +505,62 @@ int uart_rx(bool blocking)
    return c;
 }
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t uart_read(void* data, size_t length, uint16_t timeout)
+{
+   uint8_t* p = data;
+   size_t count = 0;
+
+#if UART_RX_BUFFER_SIZE > 0
+   if (CPU_SREG & CPU_I_bm)
+   {
+      uint64_t start = timer_now_ms();
+
+      while (count < length)
+      {
+         uint8_t tail = rx0.tail;
+         uint8_t index = tail & (UART_RX_BUFFER_SIZE - 1);
+         size_t available = (uint8_t) (rx0.head - tail);
+         size_t span;
+
+         if (available == 0)
+         {
+            if ((timer_now_ms() - start) >= timeout)
+               break;
+
+            continue;
+         }
+
+         if (available > (length - count))
+            available = length - count;
+
+         span = UART_RX_BUFFER_SIZE - index;
+
+         if (span > available)
+            span = available;
+
+         memcpy(&p[count], (const uint8_t*) &rx0.buffer[index], span);
+         memcpy(&p[count + span], (const uint8_t*) &rx0.buffer[0], available - span);
+
+         count += available;
+         rx0.tail = tail + available;
+      }
+   }
+   else
+#endif
+   {
+      // time does not advance with interrupts disabled, so only what has already arrived is returned
+      int c;
+
+      while ((count < length) && ((c = uart_rx(false)) != EOF))
+         p[count++] = c;
+   }
+
+   return count;
+}
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
@@ -273,15 +570,34 @@ size_t uart_rx_errors(bool reset)
 
    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
-      errors = rx0.errors;
+      errors = stats.bufovf + stats.ferr + stats.perr + stats.overrun;
 
       if (reset)
-         rx0.errors = 0;
+      {
+         stats.bufovf = 0;
+         stats.ferr = 0;
+         stats.perr = 0;
+         stats.overrun = 0;
+      }
    }
 
    return errors;
 }
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void uart_stats(uart_stats_t* s, bool reset)
+{
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+   {
+      memcpy(s, (const uart_stats_t*) &stats, sizeof(*s));
+
+      if (reset)
+         memset((uart_stats_t*) &stats, 0, sizeof(stats));
+   }
+}
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
@@ -290,16 +606,28 @@ int uart_rx_peek(size_t index)
    int c = EOF;
 
 #if UART_RX_BUFFER_SIZE > 0
-   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-   {
-      if (index < rx0.count)
-         c = rx0.buffer[(rx0.ptr + index) % UART_RX_BUFFER_SIZE];
-   }
+   uint8_t tail = rx0.tail;
+
+   if (index < (uint8_t) (rx0.head - tail))
+      c = rx0.buffer[(tail + index) & (UART_RX_BUFFER_SIZE - 1)];
 #endif
 
    return c;
 }
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void uart_rx_skip(size_t count)
+{
+#if UART_RX_BUFFER_SIZE > 0
+   uint8_t tail = rx0.tail;
+   uint8_t length = rx0.head - tail;
+
+   rx0.tail = tail + ((count < length) ? count : length);
+#endif
+}
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
@@ -308,10 +636,7 @@ size_t uart_rx_length()
    size_t length = 0;
 
 #if UART_RX_BUFFER_SIZE > 0
-   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-   {
-      length = rx0.count;
-   }
+   length = (uint8_t) (rx0.head - rx0.tail);
 #endif
 
    return length;
@@ -323,11 +648,7 @@ size_t uart_rx_length()
 void uart_rx_flush()
 {
 #if UART_RX_BUFFER_SIZE > 0
-   ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
-   {
-      rx0.ptr = 0;
-      rx0.count = 0;
-   }
+   rx0.tail = rx0.head;
 #endif
 }
 
@@ -339,7 +660,8 @@ void uart_close()
    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
    {
 #if UART_RX_BUFFER_SIZE > 0
-      USART0.CTRLA &= ~USART_RXCIE_bm;
+      USART0.CTRLA &= ~(USART_RXCIE_bm | USART_RXSIE_bm);
+      USART0.CTRLB &= ~USART_SFDEN_bm;
 #endif
       USART0.CTRLA &= ~USART_DREIE_bm;
       USART0.CTRLB &= ~(USART_RXEN_bm | USART_TXEN_bm);
@@ -353,6 +675,15 @@ void uart_close()
 #else
       PORTB.DIRCLR = PIN3_bm;
       PORTB.DIRCLR = PIN2_bm;
+#endif
+
+#ifdef UART_RS485
+      USART0.CTRLA &= ~USART_RS485_gm;
+#ifdef UART_ALTERNATE_PINS
+      PORTA.DIRCLR = PIN4_bm;
+#else
+      PORTB.DIRCLR = PIN0_bm;
+#endif
 #endif
    }
 }
@@ -360,8 +691,45 @@ void uart_close()
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void uart_init(uint32_t baud)
+int16_t uart_baud_error()
 {
+   return baud_error;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool uart_init(uint32_t baud)
+{
+   // BAUD holds clock * 64 / (samples per bit * baud), 16 samples in normal mode
+   uint32_t clock = F_CPU * 4UL;
+   uint32_t value;
+   bool clk2x = false;
+
+   baud_error = INT16_MAX;
+
+   if (baud == 0)
+      return false;
+
+   value = (clock + baud / 2) / baud;
+
+   // double speed uses 8 samples per bit, only for rates normal mode can't reach
+   if (value < 64)
+   {
+      clock *= 2;
+      value = (clock + baud / 2) / baud;
+      clk2x = true;
+   }
+
+   if ((value < 64) || (value > 0xFFFF))
+      return false;
+
+   // in units of 0.01%, positive when the actual rate is faster than requested
+   baud_error = (int32_t) (clock - value * baud) / (int32_t) ((value * baud + 5000) / 10000);
+
+   if ((baud_error > UART_BAUD_TOLERANCE) || (baud_error < -UART_BAUD_TOLERANCE))
+      return false;
+
 #ifdef UART_ALTERNATE_PINS
    PORTA.DIRSET = PIN1_bm;
    PORTA.DIRCLR = PIN2_bm;
@@ -371,10 +739,29 @@ void uart_init(uint32_t baud)
    PORTB.DIRCLR = PIN2_bm;
 #endif
 
-   USART0.BAUD = F_CPU * 64UL / (16UL * baud);
+#ifdef UART_RS485
+   // XDIR drives the transceiver DE and /RE, it stays high from the start bit until the last stop bit has left
+#ifdef UART_ALTERNATE_PINS
+   PORTA.DIRSET = PIN4_bm;
+#else
+   PORTB.DIRSET = PIN0_bm;
+#endif
+   USART0.CTRLA = (USART0.CTRLA & ~USART_RS485_gm) | USART_RS485_EXT_gc;
+#endif
+
+   USART0.BAUD = value;
+   USART0.CTRLB = (USART0.CTRLB & ~USART_RXMODE_gm) | (clk2x ? USART_RXMODE_CLK2X_gc : USART_RXMODE_NORMAL_gc);
    USART0.CTRLB |= (USART_RXEN_bm | USART_TXEN_bm);
 
 #if UART_RX_BUFFER_SIZE > 0
    USART0.CTRLA |= USART_RXCIE_bm;
+
+#ifdef UART_RX_WAKEUP
+   // start of frame detection restarts the peripheral clock in standby for the incoming byte
+   USART0.CTRLB |= USART_SFDEN_bm;
+   USART0.CTRLA |= USART_RXSIE_bm;
 #endif
+#endif
+
+   return true;
 }
@@ -8,6 +8,33 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+typedef enum
+{
+   UART_TX_BLOCK,
+   UART_TX_DROP_NEWEST,
+   UART_TX_DROP_OLDEST,
+   UART_TX_SHORT
+
+} uart_tx_policy_t;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+typedef struct
+{
+   size_t bufovf;
+   size_t ferr;
+   size_t perr;
+   size_t overrun;
+   size_t tx_dropped;
+   uint8_t rx_peak;
+   uint8_t tx_peak;
+
+} uart_stats_t;
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
@@ -23,11 +50,36 @@ void uart_tx(int c);
  *******************************************************************************************************************/
 size_t uart_tx_length();
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t uart_tx_space();
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
 void uart_tx_flush();
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t uart_write(const void* data, size_t length);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t uart_write_policy(const void* data, size_t length, uart_tx_policy_t policy);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void uart_tx_policy(uart_tx_policy_t policy);
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t uart_tx_dropped(bool reset);
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
@@ -38,16 +90,31 @@ void uart_rx_enable(bool enable);
  *******************************************************************************************************************/
 int uart_rx(bool blocking);
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+size_t uart_read(void* data, size_t length, uint16_t timeout);
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
 size_t uart_rx_errors(bool reset);
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void uart_stats(uart_stats_t* stats, bool reset);
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
 int uart_rx_peek(size_t index);
 
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+void uart_rx_skip(size_t count);
+
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
@@ -61,6 +128,11 @@ void uart_close();
 /*******************************************************************************************************************
  *
  *******************************************************************************************************************/
-void uart_init(uint32_t baud);
+int16_t uart_baud_error();
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+bool uart_init(uint32_t baud);
 
 #endif
@@ -0,0 +1,134 @@
+/*******************************************************************************************************************
+ * Host benchmark of the timer engine
+ *
+ * Times are host nanoseconds, not AVR cycles. What matters is how the cost grows with the number of registered
+ * timers, which is the same on the target because the code paths are the same.
+ *******************************************************************************************************************/
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "clock.h"
+#include "timer.h"
+
+#define TIMERS_MAX 64
+#define ROUNDS     200000
+#define REPEATS    5
+
+void RTC_CNT_vect(void);
+
+static const unsigned populations[] = { 1, 4, 16, 64 };
+static timer_t timers[TIMERS_MAX];
+static timer16_t timers16[TIMERS_MAX];
+static unsigned long expiries;
+
+// the target has 16-bit pointers and no padding
+#define AVR_SIZE(type) (2 + sizeof(((type*) 0)->flags) + sizeof(((type*) 0)->event) + \
+   sizeof(((type*) 0)->value.current) + sizeof(((type*) 0)->value.reset) + 2)
+
+static void on_timer(timer_t* timer)
+{
+   expiries++;
+}
+
+static void on_timer16(timer16_t* timer)
+{
+   expiries++;
+}
+
+static void add(unsigned count, uint16_t flags)
+{
+   unsigned i;
+
+   // periods are spread so the timers expire at different ticks
+   for (i = 0; i < count; i++)
+      timer_add(&timers[i], flags | TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, 50 + i * 37, on_timer);
+}
+
+static void remove_all(unsigned count)
+{
+   unsigned i;
+
+   for (i = 0; i < count; i++)
+      timer_remove(&timers[i]);
+}
+
+static void add16(unsigned count, uint16_t flags)
+{
+   unsigned i;
+
+   for (i = 0; i < count; i++)
+      timer16_add(&timers16[i], flags | TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, 50 + i * 37, on_timer16);
+}
+
+static void remove_all16(unsigned count)
+{
+   unsigned i;
+
+   for (i = 0; i < count; i++)
+      timer16_remove(&timers16[i]);
+}
+
+static void bench(const char* title, uint16_t flags, void (*add)(unsigned, uint16_t), void (*remove_all)(unsigned))
+{
+   unsigned p;
+
+   printf("%-44s ns/tick  expiries/1000 ticks\n", title);
+
+   for (p = 0; p < sizeof(populations) / sizeof(populations[0]); p++)
+   {
+      double best = 0;
+      unsigned r;
+
+      // the fastest of several runs is the least disturbed by the host
+      for (r = 0; r < REPEATS; r++)
+      {
+         double start;
+         double elapsed;
+         unsigned i;
+
+         // ticks left over from the previous run are consumed before the clock starts
+         timer_update();
+         add(populations[p], flags);
+         expiries = 0;
+         start = clock_ns();
+
+         // a sync timer is only serviced by timer_update(), which the main loop calls after every tick
+         for (i = 0; i < ROUNDS; i++)
+         {
+            RTC_CNT_vect();
+
+            if ((flags & TIMER_FLAG_ASYNC) == 0)
+               timer_update();
+         }
+
+         elapsed = clock_ns() - start;
+         best = ((r == 0) || (elapsed < best)) ? elapsed : best;
+         remove_all(populations[p]);
+      }
+
+      printf("   %2u timers                                 %7.1f  %7.1f\n", populations[p], best / ROUNDS,
+         expiries * 1000.0 / ROUNDS);
+   }
+}
+
+int main()
+{
+   timer_init();
+
+   // async timers sit in the delta queue, sync timers in the list or the wheel serviced by timer_update()
+   bench("RTC_CNT_vect, async timer_t", TIMER_FLAG_ASYNC, add, remove_all);
+#ifdef TIMER_WHEEL
+   bench("RTC_CNT_vect + timer_update, sync wheel", 0, add, remove_all);
+#else
+   bench("RTC_CNT_vect + timer_update, sync list", 0, add, remove_all);
+#endif
+
+   // timer16_t always uses plain lists with 16-bit arithmetic
+   bench("RTC_CNT_vect, async timer16_t", TIMER_FLAG_ASYNC, add16, remove_all16);
+   bench("RTC_CNT_vect + timer_update, sync timer16_t", 0, add16, remove_all16);
+
+   printf("RAM per timer on the target: timer_t %u bytes, timer16_t %u bytes\n", (unsigned) AVR_SIZE(timer_t),
+      (unsigned) AVR_SIZE(timer16_t));
+
+   return 0;
+}
@@ -0,0 +1,83 @@
+/*******************************************************************************************************************
+ * Host benchmark of the UART byte paths
+ *
+ * Every byte goes through uart_tx() and the data register empty interrupt on the way out, and through the receive
+ * interrupt and uart_rx() on the way in. Build with UART_DIR pointing at another uart.c/uart.h to compare versions:
+ *
+ *     make bench UART_DIR=/path/to/older/firmware
+ *
+ * Times are host nanoseconds. The interrupt masking the target pays for is not part of them.
+ *******************************************************************************************************************/
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "clock.h"
+#include "uart.h"
+
+#define ROUNDS  2000000
+#define REPEATS 5
+
+void USART0_DRE_vect(void);
+void USART0_RXC_vect(void);
+
+static double bench_tx()
+{
+   double start = clock_ns();
+   unsigned i;
+
+   for (i = 0; i < ROUNDS; i++)
+   {
+      uart_tx((int) i);
+      USART0_DRE_vect();
+   }
+
+   return (clock_ns() - start) / ROUNDS;
+}
+
+static double bench_rx()
+{
+   double start = clock_ns();
+   unsigned long sum = 0;
+   unsigned i;
+
+   for (i = 0; i < ROUNDS; i++)
+   {
+      USART0.RXDATAL = (uint8_t) i;
+      USART0_RXC_vect();
+      sum += uart_rx(false);
+   }
+
+   // the received bytes are used so the reads are not optimized away
+   if (sum == 0)
+      printf("no bytes received\n");
+
+   return (clock_ns() - start) / ROUNDS;
+}
+
+int main()
+{
+   double tx = 0;
+   double rx = 0;
+   unsigned r;
+
+   uart_init(115200);
+
+   // interrupts enabled, so both paths use the buffers, and a byte is always waiting in the receiver
+   CPU_SREG = CPU_I_bm;
+   USART0.STATUS = USART_RXCIF_bm | USART_DREIF_bm;
+
+   // the fastest of several runs is the least disturbed by the host
+   for (r = 0; r < REPEATS; r++)
+   {
+      double t = bench_tx();
+      double x = bench_rx();
+
+      tx = ((r == 0) || (t < tx)) ? t : tx;
+      rx = ((r == 0) || (x < rx)) ? x : rx;
+   }
+
+   printf("uart_tx + USART0_DRE_vect               %5.1f ns/byte\n", tx);
+   printf("USART0_RXC_vect + uart_rx               %5.1f ns/byte\n", rx);
+
+   return 0;
+}
@@ -0,0 +1,141 @@
+/*******************************************************************************************************************
+ * Jitter of the microsecond timers on a simulated TCB0
+ *
+ * TCB0 counts at CLK_PER / 2 and restarts at its compare value. The bench plays the counter: it runs to the compare
+ * value timer.c programmed, lets the interrupt in some latency later with CNT holding that latency, and calls
+ * TCB0_INT_vect(). The latency is either none or uniform up to LATENCY_US, standing in for other interrupts and
+ * atomic sections that hold off the TCB0 vector on the target. The time the ISR itself runs is not part of the model.
+ *
+ * For each requested period, including TIMER_USEC_MIN and one below it, the bench prints the mean period the callback
+ * saw, its worst deviation from the request and what timer_usec_jitter() reported.
+ *******************************************************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+
+// a one written to an interrupt flag clears it, only the simulated hardware raises one
+template <typename T> class flags
+{
+public:
+   flags& operator=(unsigned v) { value &= ~v; return *this; }
+   void raise(unsigned v) { value |= v; }
+   operator T() const { return value; }
+
+private:
+   T value;
+};
+
+#define _RFLAGS flags<uint8_t>
+
+#include <avr/io.h>
+
+RTC_t RTC;
+TCB_t TCB0;
+_R8 CPU_SREG;
+
+#include "../firmware/timer.c"
+
+#define COUNTS_US  (F_CPU / 2000000UL)
+#define FIRES      2000
+#define LATENCY_US 10
+
+#ifndef TIMER_USEC_MIN
+#define TIMER_USEC_MIN 20
+#endif
+
+static const uint32_t periods[] = { TIMER_USEC_MIN / 2, TIMER_USEC_MIN, 50, 100, 1000, 10000, 100000 };
+
+static timer_t timer;
+static uint64_t now;
+static uint64_t last;
+static unsigned long fires;
+static uint64_t sum;
+static uint64_t shortest;
+static uint64_t longest;
+static uint32_t seed = 1;
+
+static void on_timer(timer_t* timer)
+{
+   uint64_t period = now - last;
+
+   last = now;
+   fires++;
+   sum += period;
+
+   if (period < shortest)
+      shortest = period;
+
+   if (period > longest)
+      longest = period;
+}
+
+static uint16_t latency(uint16_t max)
+{
+   seed = seed * 1103515245 + 12345;
+
+   return (uint16_t) ((seed >> 16) % (max + 1));
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void run(uint32_t requested, uint16_t max)
+{
+   uint64_t base;
+   uint32_t expected = (requested < TIMER_USEC_MIN) ? TIMER_USEC_MIN : requested;
+   double early;
+   double late;
+
+   now = 0;
+   last = 0;
+   fires = 0;
+   sum = 0;
+   shortest = UINT64_MAX;
+   longest = 0;
+
+   TCB0.CNT = 0;
+   timer_usec_add(&timer, TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, requested, on_timer);
+   timer_usec_jitter(true);
+
+   // whatever timer.c leaves in CNT is the time since the counter last started
+   base = now - TCB0.CNT;
+
+   while ((fires < FIRES) && (TCB0.CTRLA & TCB_ENABLE_bm))
+   {
+      uint16_t counts = latency(max);
+
+      now = base + TCB0.CCMP + 1 + counts;
+      TCB0.CNT = counts;
+      TCB0.INTFLAGS.raise(TCB_CAPT_bm);
+      TCB0_INT_vect();
+
+      base = now - TCB0.CNT;
+   }
+
+   timer_remove(&timer);
+
+   early = (double) expected - (double) shortest / COUNTS_US;
+   late = (double) longest / COUNTS_US - expected;
+
+   printf("   %6lu us  %2u us  mean %10.3f us  worst %+7.2f us  jitter %2u us\n", (unsigned long) requested,
+      (unsigned) (max / COUNTS_US), (double) sum / fires / COUNTS_US, (late >= early) ? late : -early, timer_usec_jitter(false));
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int main()
+{
+   size_t i;
+
+   timer_init();
+
+   printf("   period  latency\n");
+
+   for (i = 0; i < sizeof(periods) / sizeof(periods[0]); i++)
+   {
+      run(periods[i], 0);
+      run(periods[i], LATENCY_US * COUNTS_US);
+   }
+
+   return 0;
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************************************************
+ * Writes the telemetry capture that test_telemetry.py decodes
+ *
+ * The records come from telemetry.c and frame.c, the uart stand-ins below put them on stdout together with what a real
+ * line carries besides them. In order:
+ *
+ *     console text before the first record
+ *     state record 0
+ *     state record 1 with a bit flipped in its CRC
+ *     a 300-byte record of an unknown type, its first COBS block is a full 254 bytes
+ *     state record 2 cut off halfway, followed by line noise and no delimiter
+ *     state records 3 and 4
+ *
+ * The capture is checked in as data/telemetry.bin, make capture rebuilds it.
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "frame.h"
+#include "telemetry.h"
+#include "timer.h"
+#include "uart.h"
+
+#define LONG_TYPE   0x02
+#define LONG_LENGTH 300
+
+typedef enum
+{
+   LINE_CLEAN,
+   LINE_BAD_CRC,
+   LINE_CUT,
+
+} line_t;
+
+static line_t line;
+static uint16_t now;
+
+/*******************************************************************************************************************
+ * The parts of uart.c and timer.c telemetry.c calls
+ *******************************************************************************************************************/
+size_t uart_tx_space()
+{
+   return 0xFFFF;
+}
+
+size_t uart_write(const void* data, size_t length)
+{
+   uint8_t buffer[FRAME_SIZE(LONG_LENGTH)];
+
+   memcpy(buffer, data, length);
+
+   // the byte before the closing delimiter is the high byte of the CRC, test_telemetry.py checks it still decodes
+   if (line == LINE_BAD_CRC)
+      buffer[length - 2] ^= 0x01;
+   else if (line == LINE_CUT)
+      length /= 2;
+
+   return fwrite(buffer, 1, length, stdout);
+}
+
+uint64_t timer_now_ms()
+{
+   return now;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void state(line_t how, uint8_t duty, uint16_t jitter)
+{
+   telemetry_state_t state = { 0 };
+
+   state.direction = -1;
+   state.duty = duty;
+   state.buttons = 0x05;
+   state.timer_jitter = jitter;
+   state.uart_errors = 3;
+
+   line = how;
+   now += 100;
+   telemetry_send(&state);
+   line = LINE_CLEAN;
+}
+
+int main()
+{
+   uint8_t record[LONG_LENGTH];
+   uint8_t buffer[FRAME_SIZE(LONG_LENGTH)];
+   size_t i;
+
+   fputs("boot 1.0\r\n", stdout);
+
+   state(LINE_CLEAN, 10, 12);
+   state(LINE_BAD_CRC, 20, 12);
+
+   record[0] = LONG_TYPE;
+
+   for (i = 1; i < LONG_LENGTH; i++)
+      record[i] = (uint8_t) (i % 255 + 1);
+
+   uart_write(buffer, frame_encode(buffer, record, sizeof(record)));
+
+   state(LINE_CUT, 30, 12);
+   fputs("\x13\x37 noise", stdout);
+
+   state(LINE_CLEAN, 40, 15);
+   state(LINE_CLEAN, 50, 15);
+
+   return 0;
+}
@@ -0,0 +1,14 @@
+/*******************************************************************************************************************
+ * Host clock for the benchmarks
+ *******************************************************************************************************************/
+#include <time.h>
+#include "clock.h"
+
+double clock_ns(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
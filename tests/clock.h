@@ -0,0 +1,6 @@
+/*******************************************************************************************************************
+ * Host clock for the benchmarks, kept apart because <time.h> declares its own timer_t
+ *******************************************************************************************************************/
+#pragma once
+
+double clock_ns(void);
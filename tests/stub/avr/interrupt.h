@@ -0,0 +1,9 @@
+/*******************************************************************************************************************
+ * Host stand-in for <avr/interrupt.h>, a test calls the vectors as plain functions
+ *******************************************************************************************************************/
+#pragma once
+#include <avr/io.h>
+
+#define ISR(vector) void vector(void); void vector(void)
+#define sei()
+#define cli()
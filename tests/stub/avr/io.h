@@ -0,0 +1,188 @@
+/*******************************************************************************************************************
+ * Host stand-in for the ATtiny3217 <avr/io.h>
+ *
+ * Registers are plain memory, so a test sets inputs and reads back what the firmware wrote. Only the registers and
+ * bit names the firmware uses are declared. A test may define _R8 and _R16 before including this header to observe
+ * the accesses, and _RFLAGS for the interrupt flag registers, which the target clears by writing a one.
+ *******************************************************************************************************************/
+#pragma once
+#include <stdint.h>
+
+#ifndef _R8
+#define _R8 volatile uint8_t
+#endif
+#ifndef _R16
+#define _R16 volatile uint16_t
+#endif
+#ifndef _RFLAGS
+#define _RFLAGS _R8
+#endif
+
+typedef struct
+{
+   _R8 CTRLA, STATUS, INTCTRL;
+   _RFLAGS INTFLAGS;
+   _R8 TEMP, DBGCTRL, CALIB, CLKSEL;
+   _R16 CNT, PER, CMP;
+   _R8 PITCTRLA, PITSTATUS, PITINTCTRL;
+   _RFLAGS PITINTFLAGS;
+   _R8 PITDBGCTRL;
+} RTC_t;
+
+typedef struct
+{
+   _R8 RXDATAL, RXDATAH, TXDATAL, TXDATAH, STATUS, CTRLA, CTRLB, CTRLC;
+   _R16 BAUD;
+   _R8 CTRLD, DBGCTRL, EVCTRL, TXPLCTRL, RXPLCTRL;
+} USART_t;
+
+typedef struct
+{
+   _R8 CTRLA, CTRLB, CTRLC, CTRLD, CTRLECLR, CTRLESET, CTRLFCLR, CTRLFSET, EVCTRL, INTCTRL;
+   _RFLAGS INTFLAGS;
+   _R8 DBGCTRL, TEMP;
+   _R16 CNT, PER, CMP0, CMP1, CMP2, PERBUF, CMP0BUF, CMP1BUF, CMP2BUF;
+} TCA_SINGLE_t;
+
+typedef struct
+{
+   _R8 CTRLA, CTRLB, CTRLC, CTRLD, CTRLECLR, CTRLESET, EVCTRL, INTCTRL;
+   _RFLAGS INTFLAGS;
+   _R8 DBGCTRL;
+   _R8 LCNT, HCNT, LPER, HPER, LCMP0, HCMP0, LCMP1, HCMP1, LCMP2, HCMP2;
+} TCA_SPLIT_t;
+
+#ifdef __cplusplus
+// register classes cannot share a union, the firmware only uses one view at a time
+typedef struct { TCA_SINGLE_t SINGLE; TCA_SPLIT_t SPLIT; } TCA_t;
+#else
+typedef union { TCA_SINGLE_t SINGLE; TCA_SPLIT_t SPLIT; } TCA_t;
+#endif
+
+typedef struct
+{
+   _R8 CTRLA, CTRLB, EVCTRL, INTCTRL;
+   _RFLAGS INTFLAGS;
+   _R8 STATUS, DBGCTRL, TEMP;
+   _R16 CNT, CCMP;
+} TCB_t;
+
+typedef struct
+{
+   _R8 DIR, DIRSET, DIRCLR, DIRTGL, OUT, OUTSET, OUTCLR, OUTTGL, IN;
+   _RFLAGS INTFLAGS;
+   _R8 PIN0CTRL, PIN1CTRL, PIN2CTRL, PIN3CTRL, PIN4CTRL, PIN5CTRL, PIN6CTRL, PIN7CTRL;
+} PORT_t;
+
+typedef struct { _R8 CTRLA, CTRLB, CTRLC, CTRLD; } PORTMUX_t;
+typedef struct { _R8 MCLKCTRLA, MCLKCTRLB, MCLKLOCK, MCLKSTATUS, OSC20MCTRLA, OSC32KCTRLA; } CLKCTRL_t;
+typedef struct { _R8 RSTFR, SWRR; } RSTCTRL_t;
+
+typedef struct
+{
+   _R8 ASYNCSTROBE, SYNCSTROBE, ASYNCCH0, ASYNCCH1, ASYNCCH2, ASYNCCH3, SYNCCH0, SYNCCH1;
+   _R8 ASYNCUSER0, ASYNCUSER1, ASYNCUSER2, ASYNCUSER3, ASYNCUSER4, ASYNCUSER5, ASYNCUSER6, ASYNCUSER7, ASYNCUSER8;
+   _R8 ASYNCUSER9, ASYNCUSER10, ASYNCUSER11, ASYNCUSER12, SYNCUSER0, SYNCUSER1;
+} EVSYS_t;
+
+extern RTC_t RTC;
+extern USART_t USART0;
+extern TCA_t TCA0;
+extern TCB_t TCB0, TCB1;
+extern PORT_t PORTA, PORTB, PORTC;
+extern PORTMUX_t PORTMUX;
+extern CLKCTRL_t CLKCTRL;
+extern RSTCTRL_t RSTCTRL;
+extern EVSYS_t EVSYS;
+extern _R8 CPU_SREG;
+
+#define _PROTECTED_WRITE(r, v) ((r) = (v))
+
+#define CPU_I_bm 0x80
+#define PIN0_bm 1
+#define PIN1_bm 2
+#define PIN2_bm 4
+#define PIN3_bm 8
+#define PIN4_bm 16
+#define PIN5_bm 32
+#define PIN6_bm 64
+#define PIN7_bm 128
+#define RTC_CMP_bm 2
+#define RTC_OVF_bm 1
+#define RTC_RTCEN_bm 1
+#define RTC_RUNSTDBY_bm 0x80
+#define RTC_CMPBUSY_bm 8
+#define RTC_PERBUSY_bm 4
+#define RTC_CNTBUSY_bm 2
+#define RTC_CTRLABUSY_bm 1
+#define RTC_PRESCALER_gm 0x78
+#define RTC_CLKSEL_INT32K_gc 0
+#define USART_TXCIF_bm 0x40
+#define USART_DREIF_bm 0x20
+#define USART_RXCIF_bm 0x80
+#define USART_RXSIF_bm 0x10
+#define USART_ISFIF_bm 0x08
+#define USART_BDF_bm 0x02
+#define USART_WFB_bm 0x01
+#define USART_DREIE_bm 0x20
+#define USART_RXCIE_bm 0x80
+#define USART_TXCIE_bm 0x40
+#define USART_RXSIE_bm 0x10
+#define USART_RS485_gm 0x03
+#define USART_RS485_OFF_gc 0
+#define USART_RS485_EXT_gc 1
+#define USART_RS485_INT_gc 2
+#define USART_RXEN_bm 0x80
+#define USART_TXEN_bm 0x40
+#define USART_SFDEN_bm 0x10
+#define USART_ODME_bm 0x08
+#define USART_RXMODE_gm 0x06
+#define USART_RXMODE_NORMAL_gc 0
+#define USART_RXMODE_CLK2X_gc 2
+#define USART_BUFOVF_bm 0x40
+#define USART_FERR_bm 0x04
+#define USART_PERR_bm 0x02
+#define PORTMUX_USART0_ALTERNATE_gc 1
+#define PORTMUX_TCA04_bm 0x10
+#define PORTMUX_TCA05_bm 0x20
+#define TCA_SINGLE_SPLITM_bm 1
+#define TCA_SPLIT_ENABLE_bm 1
+#define TCA_SPLIT_CLKSEL_gm 0x0E
+#define TCA_SPLIT_CLKSEL_DIV1_gc 0
+#define TCA_SPLIT_CLKSEL_DIV2_gc 2
+#define TCA_SPLIT_CLKSEL_DIV4_gc 4
+#define TCA_SPLIT_CLKSEL_DIV8_gc 6
+#define TCA_SPLIT_CLKSEL_DIV16_gc 8
+#define TCA_SPLIT_CLKSEL_DIV64_gc 10
+#define TCA_SPLIT_CLKSEL_DIV256_gc 12
+#define TCA_SPLIT_CLKSEL_DIV1024_gc 14
+#define TCA_SPLIT_HCMP0EN_bm 0x10
+#define TCA_SPLIT_HCMP1EN_bm 0x20
+#define TCA_SPLIT_HCMP2EN_bm 0x40
+#define TCA_SPLIT_LCMP0EN_bm 1
+#define TCA_SPLIT_HUNF_bm 2
+#define TCA_SPLIT_LUNF_bm 1
+#define TCA_SPLIT_CMD_gm 0x0C
+#define TCA_SPLIT_CMD_RESTART_gc 0x08
+#define TCA_SPLIT_CMDEN_BOTH_gc 0x03
+#define TCB_ENABLE_bm 1
+#define TCB_CLKSEL_gm 6
+#define TCB_CLKSEL_CLKDIV1_gc 0
+#define TCB_CLKSEL_CLKDIV2_gc 2
+#define TCB_CLKSEL_CLKTCA_gc 4
+#define TCB_RUNSTDBY_bm 0x40
+#define TCB_CNTMODE_gm 7
+#define TCB_CNTMODE_INT_gc 0
+#define TCB_CNTMODE_FRQ_gc 3
+#define TCB_CAPT_bm 1
+#define TCB_CAPTEI_bm 1
+#define TCB_EDGE_bm 0x10
+#define TCB_FILTER_bm 0x40
+#define PORT_ISC_gm 7
+#define PORT_ISC_BOTHEDGES_gc 1
+#define PORT_ISC_INTDISABLE_gc 0
+#define PORT_PULLUPEN_bm 8
+#define EVSYS_ASYNCCH0_PORTA_PIN6_gc 0x10
+#define EVSYS_ASYNCUSER0_ASYNCCH0_gc 3
+#define RSTCTRL_SWRE_bm 1
+#define EVSYS_ASYNCUSER11_ASYNCCH0_gc 3
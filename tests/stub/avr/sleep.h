@@ -0,0 +1,13 @@
+/*******************************************************************************************************************
+ * Host stand-in for <avr/sleep.h>
+ *******************************************************************************************************************/
+#pragma once
+
+#define SLEEP_MODE_IDLE     0
+#define SLEEP_MODE_STANDBY  2
+#define SLEEP_MODE_PWR_DOWN 4
+
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_cpu()
+#define sleep_disable()
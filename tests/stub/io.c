@@ -0,0 +1,15 @@
+/*******************************************************************************************************************
+ * Register storage for the host stand-in of <avr/io.h>
+ *******************************************************************************************************************/
+#include <avr/io.h>
+
+RTC_t RTC;
+USART_t USART0;
+TCA_t TCA0;
+TCB_t TCB0, TCB1;
+PORT_t PORTA, PORTB, PORTC;
+PORTMUX_t PORTMUX;
+CLKCTRL_t CLKCTRL;
+RSTCTRL_t RSTCTRL;
+EVSYS_t EVSYS;
+_R8 CPU_SREG;
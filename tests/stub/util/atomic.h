@@ -0,0 +1,10 @@
+/*******************************************************************************************************************
+ * Host stand-in for <util/atomic.h>, the tests are single threaded and call interrupt vectors explicitly
+ *******************************************************************************************************************/
+#pragma once
+
+#define ATOMIC_BLOCK(type)    for (int _atomic = 1; _atomic; _atomic = 0)
+#define NONATOMIC_BLOCK(type) for (int _nonatomic = 1; _nonatomic; _nonatomic = 0)
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define NONATOMIC_RESTORESTATE
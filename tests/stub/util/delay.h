@@ -0,0 +1,7 @@
+/*******************************************************************************************************************
+ * Host stand-in for <util/delay.h>
+ *******************************************************************************************************************/
+#pragma once
+
+#define _delay_ms(ms)
+#define _delay_us(us)
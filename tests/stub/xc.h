@@ -0,0 +1,5 @@
+/*******************************************************************************************************************
+ * Host stand-in for <xc.h>
+ *******************************************************************************************************************/
+#pragma once
+#include <avr/io.h>
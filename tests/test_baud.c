@@ -0,0 +1,80 @@
+/*******************************************************************************************************************
+ * uart_init() baud rate table at F_CPU = 20 MHz
+ *
+ * BAUD = 64 * F_CPU / (S * baud) rounded, with S = 16 samples per bit in normal mode and 8 with CLK2X. The error is
+ * the actual rate against the requested one in units of 0.01%, truncated toward zero.
+ *******************************************************************************************************************/
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "uart.h"
+
+static const struct
+{
+   uint32_t baud;
+   bool accepted;
+   uint16_t value;
+   bool clk2x;
+   int16_t error;
+
+} table[] =
+{
+   {    2400UL, true,  33333, false,   0 },
+   {    9600UL, true,   8333, false,   0 },
+   {   19200UL, true,   4167, false,   0 },
+   {   38400UL, true,   2083, false,   1 },
+   {   57600UL, true,   1389, false,   0 },
+   {  115200UL, true,    694, false,   6 },
+   {  230400UL, true,    347, false,   6 },
+   {  250000UL, true,    320, false,   0 },
+   {  460800UL, true,    174, false, -22 },
+   {  500000UL, true,    160, false,   0 },
+   {  921600UL, true,     87, false, -22 },
+   { 1000000UL, true,     80, false,   0 },
+   { 1250000UL, true,     64, false,   0 },
+   { 2000000UL, true,     80, true,    0 },
+   { 2500000UL, true,     64, true,    0 },
+   { 3000000UL, false,     0, false,   0 },
+   {       0UL, false,     0, false,   0 },
+};
+
+int main()
+{
+   size_t i;
+   int failed = 0;
+
+   for (i = 0; i < sizeof(table) / sizeof(table[0]); i++)
+   {
+      bool accepted;
+      bool clk2x;
+
+      USART0.BAUD = 0;
+      USART0.CTRLB = 0;
+
+      accepted = uart_init(table[i].baud);
+      clk2x = (USART0.CTRLB & USART_RXMODE_gm) == USART_RXMODE_CLK2X_gc;
+
+      if (accepted != table[i].accepted)
+      {
+         printf("FAIL %lu: %s\n", (unsigned long) table[i].baud, accepted ? "accepted" : "rejected");
+         failed = 1;
+         continue;
+      }
+
+      if (!accepted)
+         continue;
+
+      if ((USART0.BAUD != table[i].value) || (clk2x != table[i].clk2x) || (uart_baud_error() != table[i].error))
+      {
+         printf("FAIL %lu: BAUD %u%s error %d, expected %u%s error %d\n", (unsigned long) table[i].baud,
+            USART0.BAUD, clk2x ? " CLK2X" : "", uart_baud_error(), table[i].value, table[i].clk2x ? " CLK2X" : "",
+            table[i].error);
+         failed = 1;
+      }
+   }
+
+   printf("test_baud                %u rates%s\n", (unsigned) (sizeof(table) / sizeof(table[0])), failed ? ", FAILED" : "");
+
+   return failed;
+}
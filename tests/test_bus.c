@@ -0,0 +1,306 @@
+/*******************************************************************************************************************
+ * Two nodes and the host on one simulated RS-485 line
+ *
+ * bus.c is built once per node with its own BUS_ADDRESS, the node builds rename bus_update() and bus_errors() so they
+ * link side by side. Every byte a node or the host writes reaches everyone else on the line, like the real bus.
+ *******************************************************************************************************************/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "bus.h"
+#include "frame.h"
+#include "main.h"
+#include "uart.h"
+
+#define NODES     2
+#define LINE_SIZE 256
+
+void bus_update_1(const command_t* commands, size_t count);
+size_t bus_errors_1(bool reset);
+void bus_update_2(const command_t* commands, size_t count);
+size_t bus_errors_2(bool reset);
+
+typedef struct
+{
+   uint8_t address;
+   void (*update)(const command_t* commands, size_t count);
+   size_t (*errors)(bool reset);
+
+   uint8_t rx[LINE_SIZE];
+   size_t length;
+
+   unsigned executed;
+   int32_t value;
+
+} node_t;
+
+static node_t nodes[NODES] =
+{
+   { .address = 0x01, .update = bus_update_1, .errors = bus_errors_1 },
+   { .address = 0x02, .update = bus_update_2, .errors = bus_errors_2 },
+};
+
+// the node whose bus_update() is running, the uart stand-ins below act on its receiver
+static node_t* node;
+
+static uint8_t host[LINE_SIZE];
+static size_t host_length;
+static size_t host_index;
+static int failed;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static size_t line_receive(uint8_t* buffer, size_t used, const void* data, size_t length)
+{
+   // like a full receive ring, what does not fit is lost
+   if (length > (LINE_SIZE - used))
+      length = LINE_SIZE - used;
+
+   memcpy(&buffer[used], data, length);
+
+   return used + length;
+}
+
+static void line_send(const node_t* from, const void* data, size_t length)
+{
+   size_t i;
+
+   for (i = 0; i < NODES; i++)
+   {
+      if (&nodes[i] != from)
+         nodes[i].length = line_receive(nodes[i].rx, nodes[i].length, data, length);
+   }
+
+   if (from != NULL)
+      host_length = line_receive(host, host_length, data, length);
+}
+
+size_t uart_rx_length()
+{
+   return node->length;
+}
+
+int uart_rx_peek(size_t index)
+{
+   return (index < node->length) ? node->rx[index] : -1;
+}
+
+void uart_rx_skip(size_t count)
+{
+   if (count > node->length)
+      count = node->length;
+
+   memmove(node->rx, &node->rx[count], node->length - count);
+   node->length -= count;
+}
+
+size_t uart_read(void* data, size_t length, uint16_t timeout)
+{
+   if (length > node->length)
+      length = node->length;
+
+   memcpy(data, node->rx, length);
+   uart_rx_skip(length);
+
+   return length;
+}
+
+size_t uart_write_policy(const void* data, size_t length, uart_tx_policy_t policy)
+{
+   line_send(node, data, length);
+
+   return length;
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static bool command_set(const int32_t* argv)
+{
+   node->executed++;
+   node->value = argv[0];
+
+   return argv[0] >= 0;
+}
+
+static bool command_ping(const int32_t* argv)
+{
+   node->executed++;
+
+   return true;
+}
+
+static const command_t commands[] =
+{
+   { "set", 1, command_set },
+   { "ping", 0, command_ping },
+};
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void check(bool condition, const char* what)
+{
+   if (!condition)
+   {
+      printf("FAIL: %s\n", what);
+      failed = 1;
+   }
+}
+
+static void reset()
+{
+   size_t i;
+
+   for (i = 0; i < NODES; i++)
+   {
+      nodes[i].executed = 0;
+      nodes[i].value = 0;
+      nodes[i].errors(true);
+   }
+
+   host_length = 0;
+   host_index = 0;
+}
+
+static void run()
+{
+   unsigned round;
+   size_t i;
+
+   // a reply written in one round is seen by the other nodes in the next
+   for (round = 0; round < 3; round++)
+   {
+      for (i = 0; i < NODES; i++)
+      {
+         node = &nodes[i];
+         node->update(commands, SIZEOF_ARRAY(commands));
+      }
+   }
+
+   node = NULL;
+}
+
+static size_t request(uint8_t* frame, uint8_t destination, uint8_t command, const int32_t* argv, uint8_t argc)
+{
+   uint8_t data[sizeof(bus_header_t) + COMMAND_ARGUMENTS_MAX * sizeof(int32_t)] = { destination, BUS_HOST, command };
+
+   memcpy(&data[sizeof(bus_header_t)], argv, argc * sizeof(int32_t));
+
+   return frame_encode(frame, data, sizeof(bus_header_t) + argc * sizeof(int32_t));
+}
+
+// takes the next frame the host received off the line, returns its decoded length or 0 when there is none
+static size_t host_reply(uint8_t* reply)
+{
+   size_t start;
+
+   while (host_index < host_length)
+   {
+      size_t length;
+
+      for (start = host_index; (host_index < host_length) && (host[host_index] != 0); host_index++)
+         ;
+
+      length = host_index - start;
+      host_index++;
+
+      if (length > 0)
+      {
+         memcpy(reply, &host[start], length);
+
+         if (!frame_decode(reply, &length))
+            return 0;
+
+         return length;
+      }
+   }
+
+   return 0;
+}
+
+static void expect_reply(uint8_t source, uint8_t command, uint8_t status)
+{
+   uint8_t reply[LINE_SIZE];
+   size_t length = host_reply(reply);
+
+   check(length == sizeof(bus_header_t) + 1, "one reply on the line");
+
+   if (length == sizeof(bus_header_t) + 1)
+   {
+      check(reply[0] == BUS_HOST, "reply is for the host");
+      check(reply[1] == source, "reply comes from the addressed node");
+      check(reply[2] == command, "reply echoes the command");
+      check(reply[3] == status, "reply status");
+   }
+
+   check(host_reply(reply) == 0, "no other frame on the line");
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int main()
+{
+   uint8_t frame[FRAME_SIZE(sizeof(bus_header_t) + COMMAND_ARGUMENTS_MAX * sizeof(int32_t))];
+   uint8_t reply[LINE_SIZE];
+   int32_t argv[COMMAND_ARGUMENTS_MAX];
+   size_t length;
+
+   // an addressed request runs on that node only, the other node ignores both the request and the reply
+   reset();
+   argv[0] = 7;
+   line_send(NULL, frame, request(frame, 0x02, 0, argv, 1));
+   run();
+   check((nodes[1].executed == 1) && (nodes[1].value == 7), "node 2 runs its request");
+   check(nodes[0].executed == 0, "node 1 ignores a request for node 2");
+   check((nodes[0].errors(false) == 0) && (nodes[1].errors(false) == 0), "addressed request leaves no errors");
+   expect_reply(0x02, 0, BUS_STATUS_OK);
+
+   reset();
+   argv[0] = -1;
+   line_send(NULL, frame, request(frame, 0x01, 0, argv, 1));
+   run();
+   check((nodes[0].executed == 1) && (nodes[1].executed == 0), "node 1 runs its request");
+   expect_reply(0x01, 0, BUS_STATUS_ERROR);
+
+   // a broadcast runs on every node and nobody answers
+   reset();
+   argv[0] = 5;
+   line_send(NULL, frame, request(frame, BUS_BROADCAST, 0, argv, 1));
+   run();
+   check((nodes[0].executed == 1) && (nodes[0].value == 5), "node 1 runs the broadcast");
+   check((nodes[1].executed == 1) && (nodes[1].value == 5), "node 2 runs the broadcast");
+   check(host_reply(reply) == 0, "no reply to a broadcast");
+
+   // a frame with a bad CRC is dropped and counted by every node
+   reset();
+   argv[0] = 3;
+   length = request(frame, 0x01, 0, argv, 1);
+   frame[length - 3] ^= (frame[length - 3] == 0x01) ? 0x02 : 0x01;
+   line_send(NULL, frame, length);
+   run();
+   check((nodes[0].executed == 0) && (nodes[1].executed == 0), "a corrupted frame runs nowhere");
+   check((nodes[0].errors(false) == 1) && (nodes[1].errors(false) == 1), "every node counts the corrupted frame");
+   check(host_reply(reply) == 0, "no reply to a corrupted frame");
+
+   // an unknown command and a wrong argument count are answered, not run
+   reset();
+   line_send(NULL, frame, request(frame, 0x02, 9, argv, 0));
+   run();
+   expect_reply(0x02, 9, BUS_STATUS_UNKNOWN);
+
+   reset();
+   argv[0] = 1;
+   line_send(NULL, frame, request(frame, 0x01, 1, argv, 1));
+   run();
+   check(nodes[0].executed == 0, "a request with the wrong argument count is not run");
+   expect_reply(0x01, 1, BUS_STATUS_ERROR);
+
+   printf("test_bus                 %u nodes%s\n", NODES, failed ? ", FAILED" : "");
+
+   return failed;
+}
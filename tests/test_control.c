@@ -0,0 +1,194 @@
+/*******************************************************************************************************************
+ * The velocity loop against a simulated motor
+ *
+ * control.c, encoder.c and timer.c run unchanged. The motor is a first-order plant, full speed is MOTOR_EDGES edges of
+ * A per second and it reaches 63 % of a new speed after MOTOR_TAU seconds. Every RTC interrupt advances the plant,
+ * raises the pin change interrupt for each edge it passed and loads TCB1 with the period of A like the capture would.
+ * Each setpoint step must settle within SETTLE_BAND of the setpoint in less than SETTLE_MS and stay there, and the mean
+ * error over the last STEADY_MS of the step must stay below ERROR_MAX.
+ *******************************************************************************************************************/
+#include <avr/io.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "control.h"
+#include "encoder.h"
+#include "motor.h"
+#include "ramp.h"
+#include "timer.h"
+
+#define MOTOR_EDGES 8000.0
+#define MOTOR_TAU   0.040
+
+#define STEP_MS     1500
+#define STEADY_MS   250
+#define SETTLE_MS   1000
+#define SETTLE_BAND 0.05
+#define ERROR_MAX   0.01
+
+#define ENCODER_A PIN6_bm
+#define ENCODER_B PIN7_bm
+
+void RTC_CNT_vect(void);
+void PORTA_PORT_vect(void);
+
+static struct
+{
+   int16_t speed;
+   double velocity;
+   double position;
+   long edges;
+   bool a;
+
+} motor;
+
+static double now_ms;
+static int failed;
+
+/*******************************************************************************************************************
+ * The parts of motor.c and ramp.c the loop calls
+ *******************************************************************************************************************/
+void motor_set_speed(int16_t speed)
+{
+   motor.speed = speed;
+}
+
+int16_t motor_speed()
+{
+   return motor.speed;
+}
+
+void ramp_sync()
+{
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void motor_edge(bool forward)
+{
+   double velocity = fabs(motor.velocity);
+
+   motor.a = !motor.a;
+
+   // B lags A when turning forward, so the two differ right after an edge of A
+   PORTA.IN = (motor.a ? ENCODER_A : 0) | ((motor.a != forward) ? ENCODER_B : 0);
+   PORTA_PORT_vect();
+
+   // a rising edge of A captures the period since the previous one, a count past 16 bits overflows instead
+   if (motor.a)
+   {
+      double period = 2.0 * (F_CPU / 2) / velocity;
+
+      if (period < 65536.0)
+      {
+         TCB1.CCMP = (uint16_t) period;
+         TCB1.INTFLAGS |= TCB_CAPT_bm;
+      }
+      else
+         TCB1.INTFLAGS &= ~TCB_CAPT_bm;
+   }
+}
+
+static void motor_step(double dt)
+{
+   double target = MOTOR_EDGES * motor.speed / MOTOR_SPEED_MAX;
+
+   motor.velocity += (target - motor.velocity) * (1.0 - exp(-dt / MOTOR_TAU));
+   motor.position += motor.velocity * dt;
+
+   while (motor.position >= motor.edges + 1)
+   {
+      motor.edges++;
+      motor_edge(true);
+   }
+
+   while (motor.position <= motor.edges - 1)
+   {
+      motor.edges--;
+      motor_edge(false);
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void run(int32_t setpoint)
+{
+   double start = now_ms;
+   double magnitude = (setpoint < 0) ? -setpoint : setpoint;
+   double band = SETTLE_BAND * magnitude;
+   double settled = -1;
+   double error = 0;
+   unsigned samples = 0;
+
+   control_set(setpoint);
+
+   while (now_ms - start < STEP_MS)
+   {
+      // timer.c stretches some periods by a count to keep milliseconds exact
+      double dt = (RTC.PER + 1) / 32768.0;
+
+      motor_step(dt);
+      now_ms += dt * 1000;
+
+      RTC_CNT_vect();
+      timer_update();
+
+      // settled from the last time the speed entered the band and never left it again
+      if (fabs(motor.velocity - setpoint) > band)
+         settled = -1;
+      else if (settled < 0)
+         settled = now_ms - start;
+
+      // the steady state error is the mean over the end of the step
+      if (now_ms - start >= STEP_MS - STEADY_MS)
+      {
+         error += motor.velocity - setpoint;
+         samples++;
+      }
+   }
+
+   error = error / samples / magnitude;
+
+   printf("   %6ld edges/s  settled after %5.1f ms, error %+.3f %%, loop reads %ld\n", (long) setpoint, settled,
+      error * 100, (long) control_velocity());
+
+   if ((settled < 0) || (settled > SETTLE_MS))
+   {
+      printf("FAIL: %ld edges/s does not settle within %d ms\n", (long) setpoint, SETTLE_MS);
+      failed = 1;
+   }
+
+   if (fabs(error) > ERROR_MAX)
+   {
+      printf("FAIL: %ld edges/s has a steady state error of %+.3f %%\n", (long) setpoint, error * 100);
+      failed = 1;
+   }
+}
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int main()
+{
+   printf("test_control\n");
+
+   timer_init();
+   encoder_init();
+   control_init();
+
+   // slow enough for the period capture, fast enough for the edge count, then a reversal and back to slow
+   run(2000);
+   run(6000);
+   run(-3000);
+   run(500);
+
+   control_stop();
+
+   if (failed)
+      printf("test_control FAILED\n");
+
+   return failed;
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************************************************
+ * Register writes per motor transition
+ *
+ * motor.c is compiled as part of this file with registers that count every write, so the test sees what each call
+ * costs on the bus to TCA0 and PORTC. A request that changes nothing must not touch a register at all, the control loop
+ * and the ramp repeat the same request every tick.
+ *******************************************************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+
+static unsigned writes;
+
+template <typename T> class counted
+{
+public:
+   counted& operator=(unsigned v) { writes++; value = v; return *this; }
+   counted& operator|=(unsigned v) { writes++; value |= v; return *this; }
+   counted& operator&=(unsigned v) { writes++; value &= v; return *this; }
+   operator T() const { return value; }
+
+private:
+   T value;
+};
+
+#define _R8  counted<uint8_t>
+#define _R16 counted<uint16_t>
+
+#include <avr/io.h>
+
+TCA_t TCA0;
+PORT_t PORTC;
+PORTMUX_t PORTMUX;
+
+#include "../firmware/motor.c"
+
+static int failed;
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+static void expect(const char* what, unsigned count, unsigned expected)
+{
+   printf("   %-40s %2u writes\n", what, count);
+
+   if (count != expected)
+   {
+      printf("FAIL: %s, expected %u writes\n", what, expected);
+      failed = 1;
+   }
+}
+
+// the writes of one call, plus those of the period end interrupt when the call armed it
+static unsigned measure(void (*call)(void))
+{
+   writes = 0;
+   call();
+
+   if (TCA0.SPLIT.INTCTRL & TCA_SPLIT_HUNF_bm)
+      TCA0_HUNF_vect();
+
+   return writes;
+}
+
+static void forward_50() { motor_drive(MOTOR_FORWARD, 50); }
+static void forward_60() { motor_drive(MOTOR_FORWARD, 60); }
+static void reverse_60() { motor_drive(MOTOR_REVERSE, 60); }
+static void speed_0() { motor_set_speed(0); }
+static void frequency() { motor_frequency(MOTOR_PWM_FREQ); }
+
+/*******************************************************************************************************************
+ *
+ *******************************************************************************************************************/
+int main()
+{
+   printf("test_motor\n");
+
+   motor_init();
+
+   expect("coast to forward", measure(forward_50), 9);
+   expect("forward, same duty", measure(forward_50), 0);
+   expect("forward, new duty at the period end", measure(forward_60), 5);
+   expect("forward, same duty again", measure(forward_60), 0);
+   expect("forward to reverse", measure(reverse_60), 8);
+   expect("reverse, same duty", measure(reverse_60), 0);
+   expect("same PWM frequency", measure(frequency), 0);
+   expect("reverse to brake", measure(motor_brake), 5);
+   expect("brake again", measure(motor_brake), 0);
+   expect("brake to coast", measure(motor_coast), 5);
+   expect("coast again", measure(motor_coast), 0);
+   expect("speed 0 while coasting", measure(speed_0), 0);
+
+   if (failed)
+      printf("test_motor FAILED\n");
+
+   return failed;
+}
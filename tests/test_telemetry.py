@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Decode the checked-in telemetry capture with tools/telemetry.py.
+
+data/telemetry.bin is written by capture_telemetry.c from telemetry.c and
+frame.c, see there for what it holds. Every frame must decode to the record
+the firmware sent or be rejected, and the CSV output must count the records,
+the lost sequence numbers and the corrupt frames.
+"""
+import os
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TOOLS = os.path.join(HERE, "..", "tools")
+CAPTURE = os.path.join(HERE, "data", "telemetry.bin")
+
+sys.path.insert(0, TOOLS)
+import telemetry  # noqa: E402
+
+LONG = bytes([0x02]) + bytes(i % 255 + 1 for i in range(1, 300))
+
+
+def state(sequence, duty, jitter):
+    return (telemetry.RECORD_STATE, sequence, 100 * (sequence + 1), -1, duty, 0x05, 0, jitter, 0, 3)
+
+
+STATES = [state(0, 10, 12), state(3, 40, 15), state(4, 50, 15)]
+
+failed = False
+
+
+def check(condition, what):
+    global failed
+    if not condition:
+        print(f"FAIL: {what}")
+        failed = True
+
+
+def main():
+    with open(CAPTURE, "rb") as stream:
+        frames = list(telemetry.frames([stream.read()]))
+    payloads = [telemetry.decode(frame) for frame in frames]
+
+    check(len(frames) == 7, f"7 frames between the delimiters, found {len(frames)}")
+
+    if len(frames) == 7:
+        check(payloads[0] is None, "console text is not a record")
+        check(telemetry.STATE.unpack(payloads[1]) == STATES[0], "state record 0")
+
+        # the COBS layer is intact, only the CRC rejects the frame
+        check(telemetry.cobs_decode(frames[2]) is not None, "bad CRC frame is valid COBS")
+        check(payloads[2] is None, "bad CRC frame is rejected")
+
+        check(frames[3][0] == 0xFF, "long record starts with a full 254-byte block")
+        check(payloads[3] == LONG, "long record decodes across the block boundary")
+
+        check(payloads[4] is None, "cut record and noise are rejected")
+        check(telemetry.STATE.unpack(payloads[5]) == STATES[1], "state record 3 after the resync")
+        check(telemetry.STATE.unpack(payloads[6]) == STATES[2], "state record 4")
+
+    result = subprocess.run([sys.executable, os.path.join(TOOLS, "telemetry.py"), CAPTURE],
+                            capture_output=True, text=True)
+    rows = [tuple(int(value) for value in line.split(",")) for line in result.stdout.splitlines()[1:]]
+
+    check(result.returncode == 0, "telemetry.py exits cleanly")
+    check(rows == STATES, "CSV holds the three good state records")
+    check(result.stderr.strip() == "3 records, 2 lost, 3 corrupt frames", f"summary: {result.stderr.strip()}")
+
+    print(f"test_telemetry           {len(frames)} frames{', FAILED' if failed else ''}")
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
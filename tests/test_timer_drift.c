@@ -0,0 +1,163 @@
+/*******************************************************************************************************************
+ * One simulated day of RTC interrupts through timer.c
+ *
+ * The RTC runs from 32.768 kHz, so a millisecond is not a whole number of counts. 1000 ms async and sync timers,
+ * both timer_t and timer16_t, must still fire exactly 86400 times, timer_update() must report each expiry in its
+ * event set, and timer_now_ms() must read 86400000 at the end. The same source is built for the tick, tickless and
+ * wheel configurations.
+ *******************************************************************************************************************/
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "timer.h"
+
+#define DAY_MS     86400000ULL
+#define DAY_COUNTS (86400ULL * 32768)
+#define PERIOD_MS  1000
+
+#ifndef TIMER_MSEC
+#define TIMER_MSEC 1
+#endif
+
+void RTC_CNT_vect(void);
+
+static timer_t async;
+static timer_t sync;
+static timer16_t async16;
+static timer16_t sync16;
+static uint32_t fired_async;
+static uint32_t fired_sync;
+static uint32_t fired_async16;
+static uint32_t fired_sync16;
+static uint32_t events_async;
+static uint32_t events_sync;
+
+static void on_async(timer_t* timer)
+{
+   fired_async++;
+}
+
+static void on_sync(timer_t* timer)
+{
+   fired_sync++;
+}
+
+static void on_async16(timer16_t* timer)
+{
+   fired_async16++;
+}
+
+static void on_sync16(timer16_t* timer)
+{
+   fired_sync16++;
+}
+
+static void update()
+{
+   timer_events_t events = timer_update();
+
+   if (events & timer_event(&async))
+      events_async++;
+
+   if (events & timer_event(&sync))
+      events_sync++;
+}
+
+static uint64_t run_day()
+{
+   uint64_t counts = 0;
+   uint32_t interrupts = 0;
+
+#ifdef TIMER_TICKLESS
+   // the counter runs freely and the interrupt comes at the compare value timer.c programmed
+   while (counts < DAY_COUNTS)
+   {
+      uint32_t step = (uint16_t) (RTC.CMP - RTC.CNT);
+
+      if (step == 0)
+         step = 0x10000;
+
+      if (counts + step > DAY_COUNTS)
+      {
+         RTC.CNT += (uint16_t) (DAY_COUNTS - counts);
+         counts = DAY_COUNTS;
+         break;
+      }
+
+      RTC.CNT += step;
+      counts += step;
+      RTC_CNT_vect();
+
+      if ((++interrupts & 0x3F) == 0)
+         update();
+   }
+#else
+   uint32_t period = RTC.PER + 1;
+
+   // the interrupt comes every PER + 1 counts, the last one may land after the end of the day
+   // timer_update() runs well inside the sync period, like the main loop does
+   while (counts < DAY_COUNTS)
+   {
+      counts += period;
+      RTC_CNT_vect();
+
+      if ((++interrupts & 0x3F) == 0)
+         update();
+   }
+#endif
+
+   update();
+
+   return counts;
+}
+
+int main()
+{
+   uint64_t counts;
+   uint64_t now;
+   int failed = 0;
+
+   timer_init();
+
+   // adding a listed timer again replaces it, a second list entry would fire it twice or loop the list walk
+   timer_add(&async, TIMER_FLAG_PERIODIC | TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED, PERIOD_MS / 2, on_async);
+   timer_add(&sync, TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, PERIOD_MS / 2, on_sync);
+   timer_add(&async, TIMER_FLAG_PERIODIC | TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED, PERIOD_MS, on_async);
+   timer_add(&sync, TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, PERIOD_MS, on_sync);
+   timer_add(&async, TIMER_FLAG_PERIODIC | TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED, PERIOD_MS, on_async);
+   timer_add(&sync, TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, PERIOD_MS, on_sync);
+   timer16_add(&async16, TIMER_FLAG_PERIODIC | TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED, PERIOD_MS / 2, on_async16);
+   timer16_add(&async16, TIMER_FLAG_PERIODIC | TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED, PERIOD_MS, on_async16);
+   timer16_add(&sync16, TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, PERIOD_MS / 2, on_sync16);
+   timer16_add(&sync16, TIMER_FLAG_PERIODIC | TIMER_FLAG_ENABLED, PERIOD_MS, on_sync16);
+
+   counts = run_day();
+   now = timer_now_ms();
+
+   printf("%-24s %llu counts, async %lu, sync %lu, now %llu ms\n", TEST_NAME, (unsigned long long) counts,
+      (unsigned long) fired_async, (unsigned long) fired_sync, (unsigned long long) now);
+
+   if ((fired_async != DAY_MS / PERIOD_MS) || (fired_sync != DAY_MS / PERIOD_MS) ||
+      (fired_async16 != DAY_MS / PERIOD_MS) || (fired_sync16 != DAY_MS / PERIOD_MS))
+   {
+      printf("FAIL: expected %llu fires, timer16_t async %lu, sync %lu\n", DAY_MS / PERIOD_MS,
+         (unsigned long) fired_async16, (unsigned long) fired_sync16);
+      failed = 1;
+   }
+
+   // timer_update() runs far more often than the timers fire, so every expiry shows up as one event
+   if ((events_async != fired_async) || (events_sync != fired_sync))
+   {
+      printf("FAIL: events async %lu, sync %lu\n", (unsigned long) events_async, (unsigned long) events_sync);
+      failed = 1;
+   }
+
+   // a tick that is not a whole number of counts may end the day part of one tick late
+   if ((now < DAY_MS) || ((now - DAY_MS) > TIMER_MSEC))
+   {
+      printf("FAIL: timer_now_ms() drifted by %lld ms\n", (long long) (now - DAY_MS));
+      failed = 1;
+   }
+
+   return failed;
+}
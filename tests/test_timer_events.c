@@ -0,0 +1,77 @@
+/*******************************************************************************************************************
+ * Event bits handed out by timer_add() and timer16_add()
+ *
+ * The first TIMER_EVENTS_MAX timers get one bit each of the set timer_update() returns, any later timer is refused a
+ * bit and the add function says so. A timer that is added again keeps the bit it had.
+ *******************************************************************************************************************/
+#include <avr/io.h>
+#include <stdio.h>
+#include "timer.h"
+
+void RTC_CNT_vect(void);
+
+static timer_t timers[TIMER_EVENTS_MAX / 2];
+static timer16_t timers16[TIMER_EVENTS_MAX - TIMER_EVENTS_MAX / 2];
+static timer_t extra;
+static timer16_t extra16;
+
+int main()
+{
+   timer_events_t seen = 0;
+   timer_events_t events = 0;
+   int failed = 0;
+   unsigned i;
+
+   timer_init();
+
+   for (i = 0; i < sizeof(timers) / sizeof(timers[0]); i++)
+   {
+      if (!timer_add(&timers[i], TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED, 1, NULL))
+         failed = 1;
+
+      seen |= timer_event(&timers[i]);
+   }
+
+   for (i = 0; i < sizeof(timers16) / sizeof(timers16[0]); i++)
+   {
+      if (!timer16_add(&timers16[i], TIMER_FLAG_ENABLED, 1, NULL))
+         failed = 1;
+
+      seen |= timer_event(&timers16[i]);
+   }
+
+   if (failed || (seen != (timer_events_t) ~0))
+   {
+      printf("FAIL: the first %u timers must each get their own event bit\n", (unsigned) TIMER_EVENTS_MAX);
+      failed = 1;
+   }
+
+   // one more of either kind is refused, and neither can show up in the event set
+   if (timer_add(&extra, TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED, 1, NULL) || (timer_event(&extra) != 0) ||
+      timer16_add(&extra16, TIMER_FLAG_ENABLED, 1, NULL) || (timer_event(&extra16) != 0))
+   {
+      printf("FAIL: a timer beyond TIMER_EVENTS_MAX must be refused an event bit\n");
+      failed = 1;
+   }
+
+   if (!timer_add(&timers[0], TIMER_FLAG_ASYNC | TIMER_FLAG_ENABLED, 1, NULL) || (timer_event(&timers[0]) != 1))
+   {
+      printf("FAIL: a timer added again must keep its event bit\n");
+      failed = 1;
+   }
+
+   // every timer expires on the next tick, the refused ones still run
+   RTC_CNT_vect();
+   RTC_CNT_vect();
+   events = timer_update();
+
+   if ((events != (timer_events_t) ~0) || !timer_expired(&extra, false) || !timer16_expired(&extra16, false))
+   {
+      printf("FAIL: events %08lX after one tick\n", (unsigned long) events);
+      failed = 1;
+   }
+
+   printf("test_timer_events        %u bits%s\n", (unsigned) TIMER_EVENTS_MAX, failed ? ", FAILED" : "");
+
+   return failed;
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Send commands to motor boards on a shared RS-485 bus.
+
+A request is a frame (see telemetry.py) holding the destination address,
+the host address 0x00, the index of the command in the firmware command
+table and its arguments as little endian int32. The addressed node replies
+with its own address and a status byte. Nodes never reply to broadcasts
+(address 0xFF).
+
+    bus.py --serial /dev/ttyUSB0 3 duty 40
+    bus.py --serial /dev/ttyUSB0 255 stop
+    bus.py --serial /dev/ttyUSB0 1-8 duty 25
+"""
+import argparse
+import struct
+import sys
+import time
+
+from telemetry import crc16, decode, frames
+
+HOST = 0x00
+BROADCAST = 0xFF
+
+# index and argument count of each entry in the commands[] table in main.c
+COMMANDS = {"duty": (0, 1), "freq": (1, 1), "stop": (2, 0), "stats": (3, 0),
+            "speed": (4, 1), "coast": (5, 0), "brake": (6, 0), "track": (7, 1)}
+STATUS = {0: "OK", 1: "ERR", 2: "UNKNOWN"}
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code = 0
+    for byte in data:
+        if byte != 0:
+            out.append(byte)
+        if byte == 0 or len(out) - code == 0xFF:
+            out[code] = len(out) - code
+            code = len(out)
+            out.append(0)
+    out[code] = len(out) - code
+    return bytes(out)
+
+
+def request(address, command, arguments):
+    payload = struct.pack(f"<BBB{len(arguments)}i", address, HOST, command, *arguments)
+    return b"\0" + cobs_encode(payload + struct.pack("<H", crc16(payload))) + b"\0"
+
+
+def reply(stream, address, command, timeout):
+    """Wait for the reply of one node, None when it does not answer in time."""
+    deadline = time.monotonic() + timeout
+
+    def chunks():
+        while time.monotonic() < deadline:
+            yield stream.read(stream.in_waiting or 1)
+
+    for frame in frames(chunks()):
+        payload = decode(frame)
+        if payload is None or len(payload) != 4:
+            continue
+        destination, source, number, status = payload
+        if destination == HOST and source == address and number == command:
+            return status
+    return None
+
+
+def addresses(text):
+    first, _, last = text.partition("-")
+    return range(int(first, 0), int(last or first, 0) + 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("address", type=addresses, help="node address, a range such as 1-8, or 255 for all")
+    parser.add_argument("command", choices=COMMANDS)
+    parser.add_argument("arguments", type=int, nargs="*")
+    parser.add_argument("--serial", metavar="PORT", required=True)
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--timeout", type=float, default=0.1, help="seconds to wait for each reply")
+    args = parser.parse_args()
+
+    command, count = COMMANDS[args.command]
+    if len(args.arguments) != count:
+        sys.exit(f"{args.command} takes {count} argument(s)")
+
+    import serial  # pyserial
+    with serial.Serial(args.serial, args.baud, timeout=args.timeout) as stream:
+        failed = 0
+        # nodes are polled one at a time, so only one of them drives the line at any moment
+        for address in args.address:
+            stream.reset_input_buffer()
+            stream.write(request(address, command, args.arguments))
+            if address == BROADCAST:
+                continue
+            status = reply(stream, address, command, args.timeout)
+            print(f"{address:3d} {'timeout' if status is None else STATUS.get(status, status)}")
+            failed += status != 0
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
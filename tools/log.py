@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Reconstruct the tokenized log_printf() output of the firmware.
+
+With LOG_TOKENIZED the firmware sends each message as a framed record of
+type, sequence, time, the address of its format string and the int32
+arguments. The format strings are only kept in the .logfmt section of the
+ELF file, where a string's address is its offset into the section.
+
+    log.py firmware.elf capture.bin
+    log.py firmware.elf --serial /dev/ttyUSB0 --baud 9600
+"""
+import argparse
+import re
+import struct
+import sys
+
+from telemetry import decode, frames, read_file, read_serial
+
+RECORD_MESSAGE = 0x02
+
+HEADER = struct.Struct("<BBHH")
+SPECIFIER = re.compile(r"%[-+ #0]*\d*(?:\.\d+)?(?:hh|h|ll|l)?([diouxXc%])")
+
+
+def load_formats(path, name=".logfmt"):
+    """Return the raw contents of the format string section of an ELF file."""
+    with open(path, "rb") as stream:
+        elf = stream.read()
+    if elf[:4] != b"\x7fELF":
+        sys.exit(f"{path}: not an ELF file")
+    if elf[4] == 1:
+        shoff, = struct.unpack_from("<I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+        header = struct.Struct("<IIIIII")
+    else:
+        shoff, = struct.unpack_from("<Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x3A)
+        header = struct.Struct("<IIQQQQ")
+    sections = [header.unpack_from(elf, shoff + i * shentsize) for i in range(shnum)]
+    strings = sections[shstrndx]
+    for section in sections:
+        start = strings[4] + section[0]
+        if elf[start:elf.index(b"\0", start)].decode() == name:
+            return elf[section[4]:section[4] + section[5]]
+    sys.exit(f"{path}: no {name} section, was the firmware built with LOG_TOKENIZED?")
+
+
+def render(formats, address, arguments):
+    if address >= len(formats):
+        return f"<unknown format 0x{address:04X}> {arguments}"
+    text = formats[address:formats.index(b"\0", address)].decode(errors="replace")
+    values = iter(arguments)
+
+    def substitute(match):
+        if match.group(1) == "%":
+            return "%"
+        value = next(values, 0)
+        # the firmware sends every argument as int32, unsigned conversions take the raw bits back
+        if match.group(1) in "ouxX":
+            value &= 0xFFFFFFFF
+        spec = re.sub(r"(hh|h|ll|l)", "", match.group(0))
+        return spec % value
+
+    return SPECIFIER.sub(substitute, text).strip("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="firmware ELF file the capture was produced by")
+    parser.add_argument("path", nargs="?", default="-", help="recorded stream, - for stdin")
+    parser.add_argument("--serial", metavar="PORT", help="read from a serial port instead")
+    parser.add_argument("--baud", type=int, default=9600)
+    args = parser.parse_args()
+
+    formats = load_formats(args.elf)
+    chunks = read_serial(args.serial, args.baud) if args.serial else read_file(args.path)
+    records = corrupt = lost = 0
+    sequence = None
+
+    try:
+        for frame in frames(chunks):
+            payload = decode(frame)
+            if payload is None:
+                corrupt += 1
+                continue
+            if payload[0] != RECORD_MESSAGE or len(payload) < HEADER.size:
+                continue
+            _, number, time, address = HEADER.unpack_from(payload)
+            arguments = struct.unpack_from(f"<{(len(payload) - HEADER.size) // 4}i", payload, HEADER.size)
+            if sequence is not None:
+                lost += (number - sequence - 1) & 0xFF
+            sequence = number
+            records += 1
+            print(f"{time:5d} {render(formats, address, arguments)}", flush=True)
+    except KeyboardInterrupt:
+        pass
+
+    print(f"{records} messages, {lost} lost, {corrupt} corrupt frames", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
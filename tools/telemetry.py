@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Decode the COBS framed telemetry records sent by the firmware.
+
+Each record is 0x00, COBS(payload, CRC-16/CCITT little endian), 0x00. Bytes
+between records, such as console text, are skipped. Records are read from a
+recorded byte stream (a file, or - for stdin) or live from a serial port and
+printed as CSV.
+
+    telemetry.py capture.bin
+    telemetry.py --serial /dev/ttyUSB0 --baud 115200
+"""
+import argparse
+import struct
+import sys
+
+RECORD_STATE = 0x01
+
+STATE = struct.Struct("<BBHbBBBHHH")
+STATE_FIELDS = ("type", "sequence", "time", "direction", "duty", "buttons",
+                "timer_drops", "timer_jitter", "uart_dropped", "uart_errors")
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(chunks):
+    """Split a stream of byte chunks on the 0x00 delimiters."""
+    pending = bytearray()
+    for chunk in chunks:
+        for byte in chunk:
+            if byte == 0:
+                if pending:
+                    yield bytes(pending)
+                    pending.clear()
+            else:
+                pending.append(byte)
+
+
+def decode(frame):
+    """Return the record payload, or None if the frame is corrupt."""
+    data = cobs_decode(frame)
+    if data is None or len(data) < 3:
+        return None
+    payload, crc = data[:-2], data[-2] | (data[-1] << 8)
+    if crc16(payload) != crc:
+        return None
+    return payload
+
+
+def read_file(path):
+    stream = sys.stdin.buffer if path == "-" else open(path, "rb")
+    with stream:
+        while True:
+            chunk = stream.read(4096)
+            if not chunk:
+                return
+            yield chunk
+
+
+def read_serial(port, baud):
+    import serial  # pyserial, only needed for live capture
+    with serial.Serial(port, baud, timeout=1) as stream:
+        while True:
+            yield stream.read(stream.in_waiting or 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("path", nargs="?", default="-", help="recorded stream, - for stdin")
+    parser.add_argument("--serial", metavar="PORT", help="read from a serial port instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    chunks = read_serial(args.serial, args.baud) if args.serial else read_file(args.path)
+    records = corrupt = lost = 0
+    sequence = None
+
+    print(",".join(STATE_FIELDS))
+    try:
+        for frame in frames(chunks):
+            payload = decode(frame)
+            if payload is None:
+                corrupt += 1
+                continue
+            if payload[0] != RECORD_STATE or len(payload) != STATE.size:
+                continue
+            state = STATE.unpack(payload)
+            if sequence is not None:
+                lost += (state[1] - sequence - 1) & 0xFF
+            sequence = state[1]
+            records += 1
+            print(",".join(str(value) for value in state))
+    except KeyboardInterrupt:
+        pass
+
+    print(f"{records} records, {lost} lost, {corrupt} corrupt frames", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()